@@ -1,11 +1,21 @@
 #pragma once
+#include <functional>
 #include <string_view>
+#include "../../src/BVH.hpp"
+#include "../../src/Bounds.hpp"
+#include "../../src/Buffer.hpp"
 #include "../../src/Camera.hpp"
 #include "../../src/EventsCallbacks.hpp"
+#include "../../src/Frustum.hpp"
+#include "../../src/JobSystem.hpp"
 #include "../../src/Mesh.hpp"
+#include "../../src/MeshPool.hpp"
 #include "../../src/RenderTarget.hpp"
 #include "../../src/Shader.hpp"
+#include "../../src/StateCache.hpp"
 #include "../../src/Texture.hpp"
+#include "../../src/UniformBuffer.hpp"
+#include "../../src/load_mesh.hpp"
 #include "../../src/make_absolute_path.hpp"
 #include "glad/gl.h"
 #include "glm/glm.hpp"
@@ -24,6 +34,9 @@ void set_events_callbacks(std::vector<EventsCallbacks>);
 [[nodiscard("You must only use this function as the condition of a while loop: `while(gl::window_is_open()) {/*do your rendering here*/}`")]] auto
     window_is_open() -> bool;
 
+/// `callback` will be called by gl::window_is_open() at the end of each frame, right before the frame is presented. Use it to draw what you batched during the frame.
+void add_end_of_frame_callback(std::function<void()> callback);
+
 auto framebuffer_width_in_pixels() -> int;
 auto framebuffer_height_in_pixels() -> int;
 auto framebuffer_aspect_ratio() -> float;
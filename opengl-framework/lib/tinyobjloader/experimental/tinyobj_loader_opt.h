@@ -88,8 +88,9 @@ namespace tinyobj_opt {
 template <typename T, size_t stack_capacity>
 class StackAllocator : public std::allocator<T> {
  public:
-  typedef typename std::allocator<T>::pointer pointer;
-  typedef typename std::allocator<T>::size_type size_type;
+  // std::allocator<T>::pointer and the allocate() hint have been removed in C++20
+  typedef T *pointer;
+  typedef size_t size_type;
 
   // Backing store for the allocator. The container owner is responsible for
   // maintaining this for as long as any containers using this allocator are
@@ -150,13 +151,13 @@ class StackAllocator : public std::allocator<T> {
   // Actually do the allocation. Use the stack buffer if nobody has used it yet
   // and the size requested fits. Otherwise, fall through to the standard
   // allocator.
-  pointer allocate(size_type n, void *hint = 0) {
+  pointer allocate(size_type n) {
     if (source_ != NULL && !source_->used_stack_buffer_ &&
         n <= stack_capacity) {
       source_->used_stack_buffer_ = true;
       return source_->stack_buffer();
     } else {
-      return std::allocator<T>::allocate(n, hint);
+      return std::allocator<T>::allocate(n);
     }
   }
 
@@ -0,0 +1,332 @@
+#include "BVH.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace gl {
+
+namespace internal {
+/// What the build works on: the box next to its index, so that we access memory linearly while we sort the primitives, instead of jumping around in the boxes.
+struct BuildPrimitive {
+    AABB      box;
+    glm::vec3 centroid;
+    uint32_t  index;
+};
+} // namespace internal
+
+namespace {
+
+using internal::BuildPrimitive;
+
+constexpr size_t bins_count = 16;
+/// Bigger leaves are split even if the Surface Area Heuristic says it is not worth it, to bound the cost of the worst leaves.
+constexpr uint32_t max_leaf_size = 8;
+/// Cost of visiting a node, relative to the cost of intersecting a primitive.
+constexpr float traversal_cost = 1.f;
+/// Beyond that depth we split at the median instead of using the Surface Area Heuristic, which guarantees that we stay below BVH::max_depth (a median split halves the number of primitives, and there are less than 2^32 of them).
+constexpr size_t max_sah_depth = BVH::max_depth - 32;
+
+auto surface_area(AABB const& box) -> float
+{
+    if (box.is_empty())
+        return 0.f;
+    auto const size = box.max - box.min;
+    return size.x * size.y + size.y * size.z + size.z * size.x; // Half of the actual area, but we only compare areas with each other
+}
+
+struct Split {
+    glm::length_t axis{};
+    float         position{};
+    float         cost{std::numeric_limits<float>::infinity()};
+};
+
+/// Sorts the primitives in `bins_count` bins along each axis, and finds the boundary between two bins that minimizes the Surface Area Heuristic.
+/// This is a lot faster than trying every possible split, and gives trees that are almost as good ("On fast Construction of SAH-based Bounding Volume Hierarchies", Ingo Wald).
+auto find_best_split(std::span<BuildPrimitive const> primitives, AABB const& centroids_bounds) -> Split
+{
+    struct Bin {
+        AABB     box{};
+        uint32_t primitives_count{0};
+    };
+
+    auto res = Split{};
+    for (glm::length_t axis = 0; axis < 3; ++axis)
+    {
+        float const extent = centroids_bounds.max[axis] - centroids_bounds.min[axis];
+        if (extent <= 0.f)
+            continue;
+        float const scale  = static_cast<float>(bins_count) / extent;
+        auto const  bin_of = [&](BuildPrimitive const& primitive) {
+            return std::min(static_cast<size_t>((primitive.centroid[axis] - centroids_bounds.min[axis]) * scale), bins_count - 1);
+        };
+
+        auto bins = std::array<Bin, bins_count>{};
+        for (auto const& primitive : primitives)
+        {
+            auto& bin = bins[bin_of(primitive)];
+            bin.box.add(primitive.box);
+            bin.primitives_count++;
+        }
+
+        // Sweep from the right to know the cost of the right side of each split, then from the left to combine it with the cost of the left side
+        auto right_costs = std::array<float, bins_count - 1>{};
+        auto right_box   = AABB{};
+        auto right_count = uint32_t{0};
+        for (size_t i = bins_count - 1; i > 0; --i)
+        {
+            right_box.add(bins[i].box);
+            right_count += bins[i].primitives_count;
+            right_costs[i - 1] = surface_area(right_box) * static_cast<float>(right_count);
+        }
+        auto left_box   = AABB{};
+        auto left_count = uint32_t{0};
+        for (size_t i = 0; i < bins_count - 1; ++i)
+        {
+            left_box.add(bins[i].box);
+            left_count += bins[i].primitives_count;
+            float const cost = surface_area(left_box) * static_cast<float>(left_count) + right_costs[i];
+            if (cost < res.cost)
+                res = Split{.axis = axis, .position = centroids_bounds.min[axis] + static_cast<float>(i + 1) / scale, .cost = cost};
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+BVH::BVH(std::span<AABB const> boxes)
+{
+    assert(boxes.size() < std::numeric_limits<uint32_t>::max());
+    if (boxes.empty())
+        return;
+
+    auto primitives = std::vector<BuildPrimitive>{};
+    primitives.reserve(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i)
+        primitives.push_back({.box = boxes[i], .centroid = boxes[i].center(), .index = static_cast<uint32_t>(i)});
+
+    _nodes.reserve(2 * boxes.size() - 1); // A binary tree with N leaves has 2N - 1 nodes, and we have at most one primitive per leaf
+    build_node(primitives, 0, static_cast<uint32_t>(primitives.size()), 0);
+
+    _primitive_indices.reserve(primitives.size());
+    for (auto const& primitive : primitives)
+        _primitive_indices.push_back(primitive.index);
+}
+
+void BVH::build_node(std::span<internal::BuildPrimitive> primitives, uint32_t begin, uint32_t end, size_t depth)
+{
+    auto box              = AABB{};
+    auto centroids_bounds = AABB{};
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        box.add(primitives[i].box);
+        centroids_bounds.add(primitives[i].centroid);
+    }
+    auto const node_index = static_cast<uint32_t>(_nodes.size());
+    _nodes.push_back(Node{.min = box.min, .first_or_right = begin, .max = box.max, .primitives_count = end - begin});
+
+    uint32_t const primitives_count = end - begin;
+    if (primitives_count <= 1)
+        return;
+
+    auto const first = primitives.begin() + begin;
+    auto const last  = primitives.begin() + end;
+    auto       mid   = first;
+    if (depth < max_sah_depth)
+    {
+        auto const split = find_best_split(std::span{first, last}, centroids_bounds);
+        // The cost of keeping all the primitives in a leaf, vs. visiting two children and intersecting the primitives of each of them
+        float const leaf_cost  = static_cast<float>(primitives_count);
+        float const split_cost = traversal_cost + split.cost / surface_area(box);
+        if (primitives_count <= max_leaf_size && !(split_cost < leaf_cost))
+            return;
+        if (split.cost < std::numeric_limits<float>::infinity())
+            mid = std::partition(first, last, [&](BuildPrimitive const& primitive) { return primitive.centroid[split.axis] < split.position; });
+    }
+    if (mid == first || mid == last) // The SAH couldn't split (e.g. all the centroids are at the same position), so split in two halves
+    {
+        auto const extent = centroids_bounds.max - centroids_bounds.min;
+        auto const axis   = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        mid               = first + primitives_count / 2;
+        std::nth_element(first, mid, last, [&](BuildPrimitive const& a, BuildPrimitive const& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    auto const mid_index                = static_cast<uint32_t>(mid - primitives.begin());
+    _nodes[node_index].primitives_count = 0;
+    build_node(primitives, begin, mid_index, depth + 1); // The left child is right after its parent
+    _nodes[node_index].first_or_right = static_cast<uint32_t>(_nodes.size());
+    build_node(primitives, mid_index, end, depth + 1);
+}
+
+void BVH::refit(std::span<AABB const> boxes)
+{
+    assert(boxes.size() == primitives_count() && "The BVH must be refitted with the same primitives as it was built with.");
+    // The children of a node are always after it, so going backwards we update the children before their parent
+    for (size_t i = _nodes.size(); i-- > 0;)
+    {
+        auto& node = _nodes[i];
+        auto  box  = AABB{};
+        if (node.primitives_count != 0)
+        {
+            for (uint32_t j = node.first_or_right; j < node.first_or_right + node.primitives_count; ++j)
+                box.add(boxes[_primitive_indices[j]]);
+        }
+        else
+        {
+            box.add(AABB{.min = _nodes[i + 1].min, .max = _nodes[i + 1].max});
+            box.add(AABB{.min = _nodes[node.first_or_right].min, .max = _nodes[node.first_or_right].max});
+        }
+        node.min = box.min;
+        node.max = box.max;
+    }
+}
+
+auto BVH::entry_distance(Node const& node, glm::vec3 const& origin, glm::vec3 const& inverse_direction, float max_distance) -> float
+{
+    // Like AABB::intersect(), but without the division because it is done once per ray, not once per node
+    return internal::slab_entry_distance(node.min, node.max, origin, inverse_direction, max_distance);
+}
+
+void BVH::query(Frustum const& frustum, std::vector<uint32_t>& visible_indices) const
+{
+    visible_indices.clear();
+    if (_nodes.empty())
+        return;
+
+    struct StackEntry {
+        uint32_t node;
+        bool     is_fully_inside; // Then all its descendants are inside too, and we don't need to test them
+    };
+    auto   stack      = std::array<StackEntry, max_depth + 1>{};
+    size_t stack_size = 0;
+
+    stack[stack_size++] = {0, false};
+    while (stack_size > 0)
+    {
+        auto const  entry           = stack[--stack_size];
+        auto const& node            = _nodes[entry.node];
+        bool        is_fully_inside = entry.is_fully_inside;
+        if (!is_fully_inside)
+        {
+            is_fully_inside = true;
+            bool is_outside = false;
+            for (auto const& plane : frustum.planes)
+            {
+                auto const normal = glm::vec3{plane};
+                // The corners of the box that are the furthest along the normal of the plane, and the furthest against it
+                auto const positive_corner = glm::mix(node.min, node.max, glm::greaterThanEqual(normal, glm::vec3{0.f}));
+                auto const negative_corner = glm::mix(node.max, node.min, glm::greaterThanEqual(normal, glm::vec3{0.f}));
+                if (glm::dot(normal, positive_corner) + plane.w < 0.f)
+                {
+                    is_outside = true;
+                    break;
+                }
+                if (glm::dot(normal, negative_corner) + plane.w < 0.f)
+                    is_fully_inside = false;
+            }
+            if (is_outside)
+                continue;
+        }
+        if (node.primitives_count != 0)
+        {
+            visible_indices.insert(visible_indices.end(), _primitive_indices.begin() + node.first_or_right, _primitive_indices.begin() + node.first_or_right + node.primitives_count);
+            continue;
+        }
+        stack[stack_size++] = {node.first_or_right, is_fully_inside};
+        stack[stack_size++] = {entry.node + 1, is_fully_inside};
+    }
+}
+
+auto BVH::reorder_primitives() -> std::vector<uint32_t>
+{
+    auto res = std::vector<uint32_t>(_primitive_indices.size());
+    std::iota(res.begin(), res.end(), 0u);
+    std::swap(res, _primitive_indices);
+    return res;
+}
+
+auto BVH::bounds() const -> AABB
+{
+    if (_nodes.empty())
+        return {};
+    return {.min = _nodes[0].min, .max = _nodes[0].max};
+}
+
+static auto triangle_boxes(std::span<glm::vec3 const> positions, std::span<uint32_t const> indices) -> std::vector<AABB>
+{
+    auto res = std::vector<AABB>(indices.size() / 3);
+    for (size_t i = 0; i < res.size(); ++i)
+    {
+        res[i].add(positions[indices[3 * i + 0]]);
+        res[i].add(positions[indices[3 * i + 1]]);
+        res[i].add(positions[indices[3 * i + 2]]);
+    }
+    return res;
+}
+
+TriangleBVH::TriangleBVH(std::span<glm::vec3 const> positions, std::span<uint32_t const> indices)
+    : _bvh{triangle_boxes(positions, indices)}
+    , _triangle_indices{_bvh.reorder_primitives()}
+{
+    assert(indices.size() % 3 == 0 && "The indices must describe a list of triangles.");
+    _vertices.reserve(3 * _triangle_indices.size());
+    for (uint32_t const triangle_index : _triangle_indices)
+    {
+        _vertices.push_back(positions[indices[3 * triangle_index + 0]]);
+        _vertices.push_back(positions[indices[3 * triangle_index + 1]]);
+        _vertices.push_back(positions[indices[3 * triangle_index + 2]]);
+    }
+}
+
+static auto positions(MeshData const& mesh) -> std::vector<glm::vec3>
+{
+    auto const offset = mesh.position_offset();
+    assert(offset.has_value() && "TriangleBVH requires a 3D position at location 0.");
+    if (!offset.has_value())
+        return {};
+    size_t const stride = mesh.floats_per_vertex();
+    auto         res    = std::vector<glm::vec3>(mesh.vertices_count());
+    for (size_t i = 0; i < res.size(); ++i)
+        res[i] = glm::vec3{mesh.vertices[i * stride + *offset], mesh.vertices[i * stride + *offset + 1], mesh.vertices[i * stride + *offset + 2]};
+    return res;
+}
+
+TriangleBVH::TriangleBVH(MeshData const& mesh)
+    : TriangleBVH{positions(mesh), mesh.position_offset().has_value() ? std::span{mesh.indices} : std::span<uint32_t const>{}}
+{}
+
+auto TriangleBVH::raycast(Ray const& ray, float max_distance) const -> std::optional<TriangleHit>
+{
+    auto barycentric_coordinates = glm::vec2{};
+    // Möller and Trumbore's "Fast, Minimum Storage Ray/Triangle Intersection"
+    auto const intersect = [&](uint32_t triangle, Ray const& ray, float max_distance) -> std::optional<float> {
+        auto const& v0     = _vertices[3 * triangle + 0];
+        auto const  edge1  = _vertices[3 * triangle + 1] - v0;
+        auto const  edge2  = _vertices[3 * triangle + 2] - v0;
+        auto const  p      = glm::cross(ray.direction, edge2);
+        float const det    = glm::dot(edge1, p);
+        if (det == 0.f) // The ray is parallel to the triangle
+            return std::nullopt;
+        float const inverse_det = 1.f / det;
+        auto const  s           = ray.origin - v0;
+        float const u           = glm::dot(s, p) * inverse_det;
+        if (u < 0.f || u > 1.f)
+            return std::nullopt;
+        auto const  q = glm::cross(s, edge1);
+        float const v = glm::dot(ray.direction, q) * inverse_det;
+        if (v < 0.f || u + v > 1.f)
+            return std::nullopt;
+        float const distance = glm::dot(edge2, q) * inverse_det;
+        if (distance < 0.f || distance >= max_distance)
+            return std::nullopt;
+        barycentric_coordinates = {u, v}; // The BVH keeps all the hits that are closer than max_distance, so this one is the closest so far
+        return distance;
+    };
+    auto const hit = _bvh.raycast(ray, intersect, max_distance);
+    if (!hit.has_value())
+        return std::nullopt;
+    return TriangleHit{.triangle_index = _triangle_indices[hit->index], .distance = hit->distance, .barycentric_coordinates = barycentric_coordinates};
+}
+
+} // namespace gl
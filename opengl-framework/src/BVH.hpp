@@ -0,0 +1,159 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+#include "MeshData.hpp"
+#include "glm/glm.hpp"
+
+namespace gl {
+
+namespace internal {
+struct BuildPrimitive;
+}
+
+struct RayHit {
+    uint32_t index{};    // Of the primitive that was hit
+    float    distance{}; // Along the ray (see Ray)
+};
+
+/// Bounding Volume Hierarchy: a tree of boxes, where each node contains the boxes of its children, and each leaf a few primitives.
+/// It lets you find what a ray hits, or what is inside a frustum, by only looking at a handful of primitives instead of all of them.
+/// For the objects of a scene, build it over their bounds in world space (see AABB::transformed()), and refit() it when they move.
+/// To pick the exact triangle of an object, combine it with the TriangleBVH of the mesh of each object (see raycast()).
+class BVH {
+public:
+    BVH() = default;
+    /// Builds the tree with the Surface Area Heuristic, which gives trees that are very fast to query, but takes some time: do it once, when loading, rather than every frame.
+    /// The BVH refers to `boxes[i]` as primitive i.
+    explicit BVH(std::span<AABB const> boxes);
+
+    /// Updates the boxes of the nodes after the primitives moved, without changing the structure of the tree. This is a lot faster than building a new BVH, but the tree becomes less efficient as the primitives move away from where they were when it was built, so rebuild it when they move a lot.
+    /// `boxes` must contain the same primitives as when the BVH was built, in the same order.
+    void refit(std::span<AABB const> boxes);
+
+    /// The closest primitive hit by the ray. `intersect(uint32_t primitive_index, Ray const& ray, float max_distance) -> std::optional<float>` must return the distance at which the ray hits the primitive, if it does.
+    /// Only the primitives whose leaf is hit by the ray are tested, the closest leaves first, and the leaves further away than the closest hit found so far are skipped.
+    /// e.g. to pick the objects of a scene by their box: `[&](uint32_t i, gl::Ray const& ray, float max_distance) { return boxes[i].intersect(ray, max_distance); }`
+    /// or by their triangles: `[&](uint32_t i, gl::Ray const& ray, float max_distance) { auto const hit = objects[i].triangles.raycast(ray.transformed(objects[i].inverse_model_matrix), max_distance); return hit ? std::optional{hit->distance} : std::nullopt; }`
+    template<typename IntersectPrimitive>
+    auto raycast(Ray const& ray, IntersectPrimitive&& intersect, float max_distance = std::numeric_limits<float>::infinity()) const -> std::optional<RayHit>;
+
+    /// Replaces the content of `visible_indices` with the indices of the primitives that intersect the frustum (in no particular order).
+    /// Like the tests of Frustum, this is conservative: the primitives are accepted by leaves, so a few of them might be just outside of the frustum, but a visible one is never rejected.
+    /// Whole subtrees are rejected (or accepted) with a single test, which is a lot faster than FrustumCuller when most of the scene is out of view.
+    void query(Frustum const& frustum, std::vector<uint32_t>& visible_indices) const;
+
+    /// Returns the indices of the primitives in the order of the leaves, and from now on refers to the i-th of them as primitive i.
+    /// Use it to reorder your primitives, so that the ones that are tested together are next to each other in memory (see TriangleBVH).
+    auto reorder_primitives() -> std::vector<uint32_t>;
+
+    auto primitives_count() const -> size_t { return _primitive_indices.size(); }
+    auto nodes_count() const -> size_t { return _nodes.size(); }
+    /// The bounds of all the primitives.
+    auto bounds() const -> AABB;
+
+    /// Building never goes deeper, which bounds the size of the stacks used to traverse the tree.
+    static constexpr size_t max_depth = 96;
+
+private:
+    /// 32 bytes, so that two nodes fit in a cache line. The nodes are stored in depth-first order, so the left child of a node is always right after it.
+    struct Node {
+        glm::vec3 min;
+        uint32_t  first_or_right; // Leaf: index of the first primitive in _primitive_indices. Inner node: index of the right child.
+        glm::vec3 max;
+        uint32_t  primitives_count; // 0 for inner nodes
+    };
+    static_assert(sizeof(Node) == 32);
+
+    /// The distance at which the ray enters the box of the node (0 if it starts inside), or infinity if it doesn't hit it before `max_distance`.
+    static auto entry_distance(Node const& node, glm::vec3 const& origin, glm::vec3 const& inverse_direction, float max_distance) -> float;
+    void        build_node(std::span<internal::BuildPrimitive> primitives, uint32_t begin, uint32_t end, size_t depth);
+
+private:
+    std::vector<Node>     _nodes{};
+    std::vector<uint32_t> _primitive_indices{}; // The leaves reference contiguous ranges of this array
+};
+
+struct TriangleHit {
+    uint32_t  triangle_index{}; // The triangle made of the vertices `indices[3 * triangle_index]`, `indices[3 * triangle_index + 1]` and `indices[3 * triangle_index + 2]`
+    float     distance{};       // Along the ray (see Ray)
+    glm::vec2 barycentric_coordinates{}; // Weights of the 2nd and 3rd vertices of the triangle at the hit point (the 1st one weighs 1 - x - y). Use them to interpolate the attributes of the vertices.
+};
+
+/// A BVH over the triangles of a mesh, to find exactly which triangle a ray hits. Even with millions of triangles this takes a few microseconds, because only a handful of them are tested.
+/// It works in the local space of the mesh: if the mesh is drawn with a model matrix, use `ray.transformed(glm::inverse(model_matrix))`.
+class TriangleBVH {
+public:
+    TriangleBVH(std::span<glm::vec3 const> positions, std::span<uint32_t const> indices);
+    /// Requires a 3D position at location 0.
+    explicit TriangleBVH(MeshData const& mesh);
+
+    /// The closest triangle hit by the ray, on either of its faces.
+    auto raycast(Ray const& ray, float max_distance = std::numeric_limits<float>::infinity()) const -> std::optional<TriangleHit>;
+
+    auto triangles_count() const -> size_t { return _triangle_indices.size(); }
+    auto bounds() const -> AABB { return _bvh.bounds(); }
+
+private:
+    BVH                    _bvh;
+    std::vector<glm::vec3> _vertices{};         // 3 per triangle, in the order of the leaves of the BVH, so that the triangles that are tested together are next to each other in memory
+    std::vector<uint32_t>  _triangle_indices{}; // Index of each triangle in the original index buffer
+};
+
+template<typename IntersectPrimitive>
+auto BVH::raycast(Ray const& ray, IntersectPrimitive&& intersect, float max_distance) const -> std::optional<RayHit>
+{
+    if (_nodes.empty())
+        return std::nullopt;
+
+    struct StackEntry {
+        uint32_t node;
+        float    distance; // Where the ray enters the node, so that we can skip it if we found a closer hit after pushing it
+    };
+    auto       stack             = std::array<StackEntry, max_depth + 1>{};
+    size_t     stack_size        = 0;
+    auto const inverse_direction = 1.f / ray.direction;
+    auto       res               = std::optional<RayHit>{};
+
+    if (float const distance = entry_distance(_nodes[0], ray.origin, inverse_direction, max_distance); distance < max_distance)
+        stack[stack_size++] = {0, distance};
+    while (stack_size > 0)
+    {
+        auto const entry = stack[--stack_size];
+        if (entry.distance >= max_distance)
+            continue;
+        auto const& node = _nodes[entry.node];
+        if (node.primitives_count != 0)
+        {
+            for (uint32_t i = node.first_or_right; i < node.first_or_right + node.primitives_count; ++i)
+            {
+                uint32_t const primitive_index = _primitive_indices[i];
+                auto const     distance        = intersect(primitive_index, ray, max_distance);
+                if (distance.has_value() && *distance < max_distance)
+                {
+                    max_distance = *distance;
+                    res          = RayHit{.index = primitive_index, .distance = *distance};
+                }
+            }
+            continue;
+        }
+        // Push the furthest child first, so that we visit the closest one first: its hits will let us skip the other one when it is behind
+        auto near = StackEntry{entry.node + 1, entry_distance(_nodes[entry.node + 1], ray.origin, inverse_direction, max_distance)};
+        auto far  = StackEntry{node.first_or_right, entry_distance(_nodes[node.first_or_right], ray.origin, inverse_direction, max_distance)};
+        if (far.distance < near.distance)
+            std::swap(near, far);
+        if (far.distance < max_distance)
+            stack[stack_size++] = far;
+        if (near.distance < max_distance)
+            stack[stack_size++] = near;
+    }
+    return res;
+}
+
+} // namespace gl
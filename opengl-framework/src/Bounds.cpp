@@ -0,0 +1,51 @@
+#include "Bounds.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace gl {
+
+auto AABB::transformed(glm::mat4 const& transform) const -> AABB
+{
+    if (is_empty())
+        return *this;
+    // Jim Arvo's method: the extent of the new box along each axis is the sum of the extents of the old one projected on that axis
+    auto const new_center    = glm::vec3{transform * glm::vec4{center(), 1.f}};
+    auto const abs_transform = glm::mat3{glm::abs(glm::vec3{transform[0]}), glm::abs(glm::vec3{transform[1]}), glm::abs(glm::vec3{transform[2]})};
+    auto const new_half_size = abs_transform * half_size();
+    return {.min = new_center - new_half_size, .max = new_center + new_half_size};
+}
+
+auto AABB::intersect(Ray const& ray, float max_distance) const -> std::optional<float>
+{
+    float const entry = internal::slab_entry_distance(min, max, ray.origin, 1.f / ray.direction, max_distance);
+    if (entry == std::numeric_limits<float>::infinity())
+        return std::nullopt;
+    return entry;
+}
+
+auto BoundingSphere::transformed(glm::mat4 const& transform) const -> BoundingSphere
+{
+    float const max_scale = std::sqrt(std::max({
+        glm::dot(glm::vec3{transform[0]}, glm::vec3{transform[0]}),
+        glm::dot(glm::vec3{transform[1]}, glm::vec3{transform[1]}),
+        glm::dot(glm::vec3{transform[2]}, glm::vec3{transform[2]}),
+    }));
+    return {.center = glm::vec3{transform * glm::vec4{center, 1.f}}, .radius = radius * max_scale};
+}
+
+auto Ray::transformed(glm::mat4 const& transform) const -> Ray
+{
+    return {.origin = glm::vec3{transform * glm::vec4{origin, 1.f}}, .direction = glm::vec3{transform * glm::vec4{direction, 0.f}}};
+}
+
+auto compute_bounds(std::span<glm::vec3 const> points) -> Bounds
+{
+    return compute_bounds(std::as_bytes(points), points.size(), sizeof(glm::vec3), [](std::byte const* point) {
+        auto res = glm::vec3{};
+        std::memcpy(&res, point, sizeof(res));
+        return res;
+    });
+}
+
+} // namespace gl
@@ -0,0 +1,104 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <span>
+#include "glm/glm.hpp"
+
+namespace gl {
+
+/// A half-line, used to find what is under the mouse (see Camera::ray() and BVH::raycast()).
+/// The distances along a ray are measured in lengths of `direction`: they are actual distances when `direction` is normalized, and they stay comparable when you transform the ray to the local space of an object.
+struct Ray {
+    glm::vec3 origin{};
+    glm::vec3 direction{0.f, 0.f, -1.f};
+
+    auto point_at(float distance) const -> glm::vec3 { return origin + distance * direction; }
+    /// Doesn't normalize the direction, so that a point is at the same distance along the transformed ray as along the original one.
+    auto transformed(glm::mat4 const& transform) const -> Ray;
+};
+
+/// Axis-Aligned Bounding Box. The default one is empty, and grows as you add points to it.
+struct AABB {
+    glm::vec3 min{+std::numeric_limits<float>::infinity()};
+    glm::vec3 max{-std::numeric_limits<float>::infinity()};
+
+    auto is_empty() const -> bool { return min.x > max.x; }
+    auto center() const -> glm::vec3 { return (min + max) * 0.5f; }
+    auto half_size() const -> glm::vec3 { return (max - min) * 0.5f; }
+
+    void add(glm::vec3 const& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+    void add(AABB const& box)
+    {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    /// The distance at which the ray enters the box (0 if it starts inside), if it does before `max_distance`.
+    auto intersect(Ray const& ray, float max_distance = std::numeric_limits<float>::infinity()) const -> std::optional<float>;
+    /// The smallest AABB that contains this box once transformed (which is usually not a tight fit of the transformed object).
+    auto transformed(glm::mat4 const& transform) const -> AABB;
+};
+
+namespace internal {
+/// Slab test: the ray is inside the box when it is between the two planes of each axis at the same time.
+/// Returns the distance at which the ray enters the box (0 if it starts inside), or infinity if it doesn't hit it before `max_distance`.
+inline auto slab_entry_distance(glm::vec3 const& min, glm::vec3 const& max, glm::vec3 const& origin, glm::vec3 const& inverse_direction, float max_distance) -> float
+{
+    auto const t1       = (min - origin) * inverse_direction;
+    auto const t2       = (max - origin) * inverse_direction;
+    auto const infinity = glm::vec3{std::numeric_limits<float>::infinity()};
+    // A ray parallel to an axis that starts exactly on one of its planes gives 0 * infinity = NaN. It lies on a face of the box then, so this axis must not reject it
+    auto const  t_min = glm::min(glm::mix(t1, -infinity, glm::isnan(t1)), glm::mix(t2, -infinity, glm::isnan(t2)));
+    auto const  t_max = glm::max(glm::mix(t1, infinity, glm::isnan(t1)), glm::mix(t2, infinity, glm::isnan(t2)));
+    float const entry = std::max({t_min.x, t_min.y, t_min.z, 0.f});
+    float const exit  = std::min({t_max.x, t_max.y, t_max.z, max_distance});
+    return entry <= exit ? entry : infinity.x;
+}
+} // namespace internal
+
+struct BoundingSphere {
+    glm::vec3 center{};
+    float     radius{};
+
+    /// Takes the biggest scale of `transform` into account, so the result still contains the object even if the scale is not uniform.
+    auto transformed(glm::mat4 const& transform) const -> BoundingSphere;
+};
+
+/// The bounds of the same set of points, as a box and as a sphere. The sphere is not the tightest one, but it is centered on the box, which makes it cheap to compute and good enough for culling.
+struct Bounds {
+    AABB           box{};
+    BoundingSphere sphere{};
+};
+
+/// `positions` contains `points_count` points, each of them starting `stride` bytes after the previous one. `read` converts the bytes of one point to a position.
+/// This way it works with any vertex layout and format (see Mesh, which computes its bounds with it).
+template<typename ReadPosition>
+auto compute_bounds(std::span<std::byte const> positions, size_t points_count, size_t stride, ReadPosition&& read) -> Bounds
+{
+    auto res = Bounds{};
+    for (size_t i = 0; i < points_count; ++i)
+        res.box.add(read(positions.data() + i * stride)); // NOLINT(*pointer-arithmetic)
+    if (res.box.is_empty())
+        return res;
+
+    res.sphere.center    = res.box.center();
+    float radius_squared = 0.f;
+    for (size_t i = 0; i < points_count; ++i)
+    {
+        auto const offset = read(positions.data() + i * stride) - res.sphere.center; // NOLINT(*pointer-arithmetic)
+        radius_squared    = std::max(radius_squared, glm::dot(offset, offset));
+    }
+    res.sphere.radius = std::sqrt(radius_squared);
+    return res;
+}
+
+auto compute_bounds(std::span<glm::vec3 const> points) -> Bounds;
+
+} // namespace gl
@@ -0,0 +1,39 @@
+#include "Buffer.hpp"
+#include <cassert>
+
+namespace gl {
+
+Buffer::Buffer(std::span<std::byte const> data, BufferUsage usage)
+    : _size_in_bytes{data.size()}
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id()); // GL_COPY_WRITE_BUFFER is not used by any draw call, so binding to it doesn't mess with the state of the rest of the app
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(data.size()), data.data(), static_cast<GLenum>(usage));
+}
+
+Buffer::Buffer(size_t size_in_bytes, BufferUsage usage)
+    : _size_in_bytes{size_in_bytes}
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id());
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size_in_bytes), nullptr, static_cast<GLenum>(usage));
+}
+
+void Buffer::set_data(std::span<std::byte const> data, size_t offset_in_bytes)
+{
+    assert(offset_in_bytes + data.size() <= _size_in_bytes && "The data doesn't fit in the buffer.");
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset_in_bytes), static_cast<GLsizeiptr>(data.size()), data.data());
+}
+
+void Buffer::get_data(std::span<std::byte> out, size_t offset_in_bytes) const
+{
+    assert(offset_in_bytes + out.size() <= _size_in_bytes && "You are trying to read past the end of the buffer.");
+    glBindBuffer(GL_COPY_READ_BUFFER, id());
+    glGetBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(offset_in_bytes), static_cast<GLsizeiptr>(out.size()), out.data());
+}
+
+void Buffer::bind_as_storage_buffer(GLuint binding_index) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding_index, id());
+}
+
+} // namespace gl
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include "glad/gl.h"
+
+namespace gl {
+
+namespace internal {
+class UniqueBuffer {
+public:
+    UniqueBuffer() // NOLINT(*-member-init)
+    {
+        glGenBuffers(1, &_id);
+    }
+    ~UniqueBuffer()
+    {
+        glDeleteBuffers(1, &_id);
+    }
+    UniqueBuffer(UniqueBuffer const&)                    = delete; // You cannot copy
+    auto operator=(UniqueBuffer const&) -> UniqueBuffer& = delete; // a Buffer. But you can move it, using std::move(my_buffer)
+    UniqueBuffer(UniqueBuffer&& o) noexcept
+        : _id{o._id}
+    {
+        o._id = 0;
+    }
+    auto operator=(UniqueBuffer&& o) noexcept -> UniqueBuffer&
+    {
+        if (&o != this)
+        {
+            glDeleteBuffers(1, &_id);
+            _id   = o._id;
+            o._id = 0;
+        }
+        return *this;
+    }
+
+    auto id() const { return _id; }
+
+private:
+    GLuint _id;
+};
+} // namespace internal
+
+/// Hint that tells the driver how often you will modify the data of a buffer, so that it can put it in the most appropriate memory.
+/// See https://registry.khronos.org/OpenGL-Refpages/gl4/html/glBufferData.xhtml for more details
+enum class BufferUsage : GLenum {
+    Static  = GL_STATIC_DRAW,  /// Set once, used many times
+    Dynamic = GL_DYNAMIC_DRAW, /// Modified from time to time, used many times
+    Stream  = GL_STREAM_DRAW,  /// Modified before (almost) each use
+};
+
+/// A block of GPU memory. It can be used as a shader storage buffer (SSBO), as a vertex buffer, etc.
+class Buffer {
+public:
+    explicit Buffer(std::span<std::byte const> data, BufferUsage = BufferUsage::Static);
+    template<typename T>
+    explicit Buffer(std::span<T> data, BufferUsage usage = BufferUsage::Static)
+        : Buffer{std::as_bytes(data), usage}
+    {}
+    /// Allocates the memory without initializing it.
+    explicit Buffer(size_t size_in_bytes, BufferUsage = BufferUsage::Static);
+
+    auto id() const -> GLuint { return _id.id(); }
+    auto size_in_bytes() const -> size_t { return _size_in_bytes; }
+
+    /// Overwrites part of the buffer. The data must fit in the buffer.
+    void set_data(std::span<std::byte const> data, size_t offset_in_bytes = 0);
+    template<typename T>
+    void set_data(std::span<T> data, size_t offset_in_bytes = 0)
+    {
+        set_data(std::as_bytes(data), offset_in_bytes);
+    }
+
+    /// Reads the buffer back into CPU memory. This waits for the GPU to be done writing to the buffer, so it is slow: use it for debugging and tests.
+    void get_data(std::span<std::byte> out, size_t offset_in_bytes = 0) const;
+    template<typename T>
+    void get_data(std::span<T> out, size_t offset_in_bytes = 0) const
+    {
+        get_data(std::as_writable_bytes(out), offset_in_bytes);
+    }
+
+    /// Makes the buffer available to shaders, as the `buffer` block declared with `layout(std430, binding = binding_index)`.
+    void bind_as_storage_buffer(GLuint binding_index) const;
+
+private:
+    internal::UniqueBuffer _id{};
+    size_t                 _size_in_bytes{};
+};
+
+} // namespace gl
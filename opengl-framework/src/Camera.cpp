@@ -2,6 +2,7 @@
 #include "EventsCallbacks.hpp"
 #include "glfw.hpp"
 #include "glm/common.hpp"
+#include "glm/ext/matrix_clip_space.hpp"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/gtc/matrix_access.hpp"
 
@@ -17,6 +18,25 @@ Camera::Camera(glm::vec3 const& position, glm::vec3 const& look_at)
 {
 }
 
+auto Camera::projection_matrix(float aspect_ratio) const -> glm::mat4
+{
+    return glm::perspective(_projection.field_of_view_in_radians, aspect_ratio, _projection.near_plane, _projection.far_plane);
+}
+
+auto Camera::ray(glm::vec2 mouse_position, float aspect_ratio) const -> Ray
+{
+    // gl::mouse_position() goes from -aspect_ratio to +aspect_ratio horizontally, and from -1 to +1 vertically
+    auto const position_in_ndc    = glm::vec2{mouse_position.x / aspect_ratio, mouse_position.y};
+    auto const inverse_projection = inverse_view_projection_matrix(aspect_ratio);
+    auto const unproject          = [&](float depth_in_ndc) {
+        auto const point = inverse_projection * glm::vec4{position_in_ndc, depth_in_ndc, 1.f};
+        return glm::vec3{point} / point.w;
+    };
+    auto const near_point = unproject(-1.f);
+    auto const far_point  = unproject(+1.f);
+    return {.origin = near_point, .direction = glm::normalize(far_point - near_point)};
+}
+
 auto Camera::right_axis() const -> glm::vec3
 {
     return glm::normalize(glm::column(_transform_matrix, 0));
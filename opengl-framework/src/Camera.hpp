@@ -1,10 +1,17 @@
 #pragma once
-// #include "Projection_Perspective.h"
 #include "EventsCallbacks.hpp"
+#include "Frustum.hpp"
 #include "glm/glm.hpp"
 
 namespace gl {
 
+struct PerspectiveProjection {
+    float field_of_view_in_radians{glm::radians(60.f)}; // Vertical
+    /// The depth buffer is a lot more precise when near_plane is not too small, so don't make it smaller than you need.
+    float near_plane{0.01f};
+    float far_plane{100.f};
+};
+
 namespace internal {
 enum class CameraControllerState {
     Idle,
@@ -19,19 +26,24 @@ public:
 
     auto transform_matrix() const -> glm::mat4 { return _transform_matrix; }
     auto view_matrix() const -> glm::mat4 { return glm::inverse(_transform_matrix); }
-    // auto      projection_matrix(float aspect_ratio) const -> glm::mat4 { return Cool::projection_matrix(_projection, aspect_ratio); }
-    // auto      inverse_projection_matrix(float aspect_ratio) const -> glm::mat4 { return glm::inverse(projection_matrix(aspect_ratio)); }
-    // auto      inverse_view_projection_matrix(float aspect_ratio) const -> glm::mat4;
-    // auto      view_projection_matrix(float aspect_ratio) const -> glm::mat4;
+    auto projection_matrix(float aspect_ratio) const -> glm::mat4;
+    auto inverse_projection_matrix(float aspect_ratio) const -> glm::mat4 { return glm::inverse(projection_matrix(aspect_ratio)); }
+    auto view_projection_matrix(float aspect_ratio) const -> glm::mat4 { return projection_matrix(aspect_ratio) * view_matrix(); }
+    auto inverse_view_projection_matrix(float aspect_ratio) const -> glm::mat4 { return _transform_matrix * inverse_projection_matrix(aspect_ratio); }
+    /// The volume seen by the camera, in world space. Objects whose bounds don't intersect it are not visible, so you don't need to draw them (see FrustumCuller).
+    auto frustum(float aspect_ratio) const -> Frustum { return Frustum::from_matrix(view_projection_matrix(aspect_ratio)); }
+    /// The ray that starts on the near plane and goes through the point under the mouse, in world space. Use it to pick objects (see BVH::raycast()).
+    /// `mouse_position` is expressed like gl::mouse_position() and the positions of the EventsCallbacks. `aspect_ratio` must be the one you draw with.
+    auto ray(glm::vec2 mouse_position, float aspect_ratio) const -> Ray;
     auto right_axis() const -> glm::vec3;
     auto up_axis() const -> glm::vec3;
     auto front_axis() const -> glm::vec3;
     auto position() const -> glm::vec3;
-    // float     far_plane() const { return _projection.far_plane; }
-    // float&    far_plane() { return _projection.far_plane; }
+    auto far_plane() const -> float { return _projection.far_plane; }
+    auto far_plane() -> float& { return _projection.far_plane; }
 
-    // auto projection() -> Projection_Perspective& { return _projection; }
-    // auto projection() const -> const Projection_Perspective& { return _projection; }
+    auto projection() -> PerspectiveProjection& { return _projection; }
+    auto projection() const -> PerspectiveProjection const& { return _projection; }
 
     void set_transform_matrix(glm::mat4 const& transform_matrix) { _transform_matrix = transform_matrix; }
     void set_view_matrix(glm::mat4 const& view_matrix) { _transform_matrix = glm::inverse(view_matrix); }
@@ -51,7 +63,7 @@ private:
     internal::CameraControllerState _state{internal::CameraControllerState::Idle};
     int                             _current_button{};
     glm::vec2                       _previous_mouse_pos{};
-    // Projection_Perspective _projection{};
+    PerspectiveProjection           _projection{};
 };
 
 } // namespace gl
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "FileWatcher.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <utility>
+#include "handle_error.hpp"
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace gl::internal {
+
+FileWatcher::FileWatcher()
+{
+#if defined(__linux__)
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify < 0)
+        handle_error("[FileWatcher] Failed to initialize inotify.");
+#endif
+    _thread = std::thread{[this]() { watcher_loop(); }};
+}
+
+FileWatcher::~FileWatcher()
+{
+    _should_stop.store(true);
+    _thread.join();
+#if defined(__linux__)
+    close(_inotify);
+#endif
+}
+
+void FileWatcher::watch(std::filesystem::path const& file)
+{
+    assert(file.is_absolute());
+    auto const path = file.lexically_normal();
+
+    std::lock_guard lock{_mutex};
+    if (std::any_of(_files.begin(), _files.end(), [&](WatchedFile const& watched) { return watched.path == path; }))
+        return;
+    auto error = std::error_code{};
+    _files.push_back({.path = path, .last_write_time = std::filesystem::last_write_time(path, error)});
+
+#if defined(__linux__)
+    // We watch the folder rather than the file itself, because many editors save by writing a new file and renaming it over the old one, which would remove a watch on the file
+    auto const folder = path.parent_path();
+    if (std::any_of(_folders.begin(), _folders.end(), [&](WatchedFolder const& watched) { return watched.path == folder; }))
+        return;
+    int const watch_descriptor = inotify_add_watch(_inotify, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch_descriptor < 0)
+        handle_error(std::format("[FileWatcher] Failed to watch folder \"{}\".", folder.string()));
+    _folders.push_back({.watch_descriptor = watch_descriptor, .path = folder});
+#endif
+}
+
+auto FileWatcher::take_changed_files() -> std::vector<std::filesystem::path>
+{
+    std::lock_guard lock{_mutex};
+    return std::exchange(_changed_files, {});
+}
+
+void FileWatcher::on_file_changed(std::filesystem::path const& file)
+{
+    // Must be called with _mutex locked
+    if (std::find(_changed_files.begin(), _changed_files.end(), file) == _changed_files.end())
+        _changed_files.push_back(file);
+}
+
+#if defined(__linux__)
+void FileWatcher::watcher_loop()
+{
+    alignas(inotify_event) char buffer[4096]; // NOLINT(*avoid-c-arrays)
+    while (!_should_stop.load())
+    {
+        auto poll_descriptor = pollfd{.fd = _inotify, .events = POLLIN, .revents = 0};
+        if (poll(&poll_descriptor, 1, 100 /*milliseconds*/) <= 0) // Wake up regularly to check _should_stop
+            continue;
+
+        while (true)
+        {
+            auto const length = read(_inotify, buffer, sizeof(buffer));
+            if (length <= 0)
+                break;
+            std::lock_guard lock{_mutex};
+            for (ssize_t offset = 0; offset < length;)
+            {
+                auto const* event = reinterpret_cast<inotify_event const*>(buffer + offset); // NOLINT(*reinterpret-cast, *pointer-arithmetic)
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                if (event->len == 0)
+                    continue;
+                auto const folder = std::find_if(_folders.begin(), _folders.end(), [&](WatchedFolder const& watched) { return watched.watch_descriptor == event->wd; });
+                if (folder == _folders.end())
+                    continue;
+                auto const path = folder->path / event->name; // NOLINT(*array-to-pointer-decay)
+                if (std::any_of(_files.begin(), _files.end(), [&](WatchedFile const& watched) { return watched.path == path; }))
+                    on_file_changed(path);
+            }
+        }
+    }
+}
+#else
+void FileWatcher::watcher_loop()
+{
+    while (!_should_stop.load())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{250});
+        std::lock_guard lock{_mutex};
+        for (auto& file : _files)
+        {
+            auto       error           = std::error_code{};
+            auto const last_write_time = std::filesystem::last_write_time(file.path, error);
+            if (error || last_write_time == file.last_write_time) // The file might be missing for a short time while an editor saves it
+                continue;
+            file.last_write_time = last_write_time;
+            on_file_changed(file.path);
+        }
+    }
+}
+#endif
+
+} // namespace gl::internal
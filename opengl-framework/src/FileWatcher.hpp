@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gl::internal {
+
+/// Watches files from a background thread, so that checking for changes costs nothing on the main thread.
+/// Uses inotify on Linux, and polls the last write time of the files every few hundred milliseconds on other platforms.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+    FileWatcher(FileWatcher const&)                    = delete;
+    auto operator=(FileWatcher const&) -> FileWatcher& = delete;
+    FileWatcher(FileWatcher&&)                         = delete;
+    auto operator=(FileWatcher&&) -> FileWatcher&      = delete;
+
+    /// Does nothing if the file is already watched. `file` must be an absolute path.
+    void watch(std::filesystem::path const& file);
+    /// Returns the files that changed since the last call. Each file appears at most once.
+    auto take_changed_files() -> std::vector<std::filesystem::path>;
+
+private:
+    void watcher_loop();
+    void on_file_changed(std::filesystem::path const& file);
+
+private:
+    struct WatchedFile {
+        std::filesystem::path           path{};
+        std::filesystem::file_time_type last_write_time{};
+    };
+
+    std::mutex                         _mutex{};
+    std::vector<WatchedFile>           _files{};
+    std::vector<std::filesystem::path> _changed_files{};
+    std::atomic<bool>                  _should_stop{false};
+#if defined(__linux__)
+    struct WatchedFolder {
+        int                   watch_descriptor{};
+        std::filesystem::path path{};
+    };
+
+    int                        _inotify{-1};
+    std::vector<WatchedFolder> _folders{};
+#endif
+    std::thread _thread{}; // Must be last, so that everything it uses is constructed before it starts
+};
+
+} // namespace gl::internal
@@ -0,0 +1,140 @@
+#include "Frustum.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+namespace gl {
+
+auto Frustum::from_matrix(glm::mat4 const& view_projection_matrix) -> Frustum
+{
+    // The rows of the matrix, combined, give the planes of the clip space (-w <= x <= w, etc.)
+    auto const row = [&](glm::length_t i) {
+        return glm::vec4{view_projection_matrix[0][i], view_projection_matrix[1][i], view_projection_matrix[2][i], view_projection_matrix[3][i]};
+    };
+    auto res = Frustum{.planes = {
+                           row(3) + row(0), // Left
+                           row(3) - row(0), // Right
+                           row(3) + row(1), // Bottom
+                           row(3) - row(1), // Top
+                           row(3) + row(2), // Near
+                           row(3) - row(2), // Far
+                       }};
+    for (auto& plane : res.planes) // Normalize, so that the distances are actual distances, which we can compare with the radius of a sphere
+        plane /= glm::length(glm::vec3{plane});
+    return res;
+}
+
+auto Frustum::intersects(BoundingSphere const& sphere) const -> bool
+{
+    return std::all_of(planes.begin(), planes.end(), [&](glm::vec4 const& plane) {
+        return glm::dot(glm::vec3{plane}, sphere.center) + plane.w >= -sphere.radius;
+    });
+}
+
+auto Frustum::intersects(AABB const& box) const -> bool
+{
+    if (box.is_empty())
+        return false;
+    return std::all_of(planes.begin(), planes.end(), [&](glm::vec4 const& plane) {
+        // The corner of the box that is the furthest along the normal of the plane
+        auto const corner = glm::mix(box.min, box.max, glm::greaterThanEqual(glm::vec3{plane}, glm::vec3{0.f}));
+        return glm::dot(glm::vec3{plane}, corner) + plane.w >= 0.f;
+    });
+}
+
+auto FrustumCuller::push(BoundingSphere const& sphere) -> uint32_t
+{
+    _xs.push_back(sphere.center.x);
+    _ys.push_back(sphere.center.y);
+    _zs.push_back(sphere.center.z);
+    _radii.push_back(sphere.radius);
+    return static_cast<uint32_t>(_radii.size() - 1);
+}
+
+void FrustumCuller::set(uint32_t index, BoundingSphere const& sphere)
+{
+    assert(index < size());
+    _xs[index]    = sphere.center.x;
+    _ys[index]    = sphere.center.y;
+    _zs[index]    = sphere.center.z;
+    _radii[index] = sphere.radius;
+}
+
+void FrustumCuller::clear()
+{
+    _xs.clear();
+    _ys.clear();
+    _zs.clear();
+    _radii.clear();
+}
+
+void FrustumCuller::reserve(size_t spheres_count)
+{
+    _xs.reserve(spheres_count);
+    _ys.reserve(spheres_count);
+    _zs.reserve(spheres_count);
+    _radii.reserve(spheres_count);
+}
+
+/// Appends `first + i` to `out` for each bit i that is set in `mask`.
+static void push_visible_indices(uint32_t mask, uint32_t first, std::vector<uint32_t>& out)
+{
+    while (mask != 0)
+    {
+        out.push_back(first + static_cast<uint32_t>(std::countr_zero(mask)));
+        mask &= mask - 1; // Clears the lowest set bit
+    }
+}
+
+void FrustumCuller::cull(Frustum const& frustum, std::vector<uint32_t>& visible_indices) const
+{
+    visible_indices.clear();
+    size_t const count = size();
+    size_t       i     = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8)
+    {
+        auto const x       = _mm256_loadu_ps(_xs.data() + i);
+        auto const y       = _mm256_loadu_ps(_ys.data() + i);
+        auto const z       = _mm256_loadu_ps(_zs.data() + i);
+        auto const minus_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(_radii.data() + i));
+        auto       visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (auto const& plane : frustum.planes)
+        {
+            auto distance = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+            distance      = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(plane.y)));
+            distance      = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(plane.z)));
+            visible       = _mm256_and_ps(visible, _mm256_cmp_ps(distance, minus_r, _CMP_GE_OQ));
+        }
+        push_visible_indices(static_cast<uint32_t>(_mm256_movemask_ps(visible)), static_cast<uint32_t>(i), visible_indices);
+    }
+#endif
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    for (; i + 4 <= count; i += 4)
+    {
+        auto const x       = _mm_loadu_ps(_xs.data() + i);
+        auto const y       = _mm_loadu_ps(_ys.data() + i);
+        auto const z       = _mm_loadu_ps(_zs.data() + i);
+        auto const minus_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(_radii.data() + i));
+        auto       visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (auto const& plane : frustum.planes)
+        {
+            auto distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            distance      = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+            distance      = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+            visible       = _mm_and_ps(visible, _mm_cmpge_ps(distance, minus_r));
+        }
+        push_visible_indices(static_cast<uint32_t>(_mm_movemask_ps(visible)), static_cast<uint32_t>(i), visible_indices);
+    }
+#endif
+    for (; i < count; ++i) // Scalar fallback, and leftovers that don't fill a whole SIMD register
+    {
+        if (frustum.intersects(BoundingSphere{.center = {_xs[i], _ys[i], _zs[i]}, .radius = _radii[i]}))
+            visible_indices.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+} // namespace gl
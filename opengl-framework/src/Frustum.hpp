@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Bounds.hpp"
+#include "glm/glm.hpp"
+
+namespace gl {
+
+/// The volume seen by a camera, as 6 planes (left, right, bottom, top, near, far).
+/// Each plane is stored as (normal, distance) with the normal pointing inside the frustum, so a point p is on the inner side of the plane when dot(normal, p) + distance >= 0.
+struct Frustum {
+    std::array<glm::vec4, 6> planes{};
+
+    /// Extracts the planes from a projection matrix, or from a view-projection matrix to get them in world space (Gribb and Hartmann's method).
+    static auto from_matrix(glm::mat4 const& view_projection_matrix) -> Frustum;
+
+    /// These tests are conservative: they can say that an object that is just outside of a corner of the frustum is visible, but never that a visible object is not.
+    auto intersects(BoundingSphere const&) const -> bool;
+    auto intersects(AABB const&) const -> bool;
+};
+
+/// Tests many bounding spheres against a frustum at once, using SIMD to test 4 spheres at a time (or 8 when the framework is compiled with AVX).
+/// The spheres are stored as a structure of arrays (all the Xs, then all the Ys, etc.), which is what makes them fast to load in SIMD registers.
+class FrustumCuller {
+public:
+    /// Returns the index of the sphere, which is what cull() will give you back.
+    auto push(BoundingSphere const& sphere) -> uint32_t;
+    void set(uint32_t index, BoundingSphere const& sphere);
+    void clear();
+    void reserve(size_t spheres_count);
+    auto size() const -> size_t { return _radii.size(); }
+
+    /// Replaces the content of `visible_indices` with the indices of the spheres that intersect the frustum, in increasing order.
+    void cull(Frustum const& frustum, std::vector<uint32_t>& visible_indices) const;
+
+private:
+    std::vector<float> _xs{};
+    std::vector<float> _ys{};
+    std::vector<float> _zs{};
+    std::vector<float> _radii{};
+};
+
+} // namespace gl
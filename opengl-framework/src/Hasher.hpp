@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace gl::internal {
+
+/// FNV-1a. Good enough to identify the files and programs we cache on disk: we only need to tell apart a few hundred of them, so 64 bits are plenty.
+class Hasher {
+public:
+    void add(std::string_view bytes)
+    {
+        for (char const c : bytes)
+        {
+            _hash ^= static_cast<uint8_t>(c);
+            _hash *= 0x100000001B3;
+        }
+        add_separator();
+    }
+    void add(uint64_t value)
+    {
+        add(std::string_view{reinterpret_cast<char const*>(&value), sizeof(value)}); // NOLINT(*reinterpret-cast)
+    }
+
+    auto hash() const -> uint64_t { return _hash; }
+
+private:
+    void add_separator()
+    {
+        // Makes sure that {"ab", "c"} and {"a", "bc"} don't hash to the same value
+        _hash ^= 0xFF;
+        _hash *= 0x100000001B3;
+    }
+
+private:
+    uint64_t _hash{0xCBF29CE484222325};
+};
+
+} // namespace gl::internal
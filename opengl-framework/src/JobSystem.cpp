@@ -0,0 +1,134 @@
+#include "JobSystem.hpp"
+#include <cassert>
+
+namespace gl {
+
+JobSystem::JobSystem(size_t workers_count)
+{
+    _queues.reserve(workers_count + 1);
+    for (size_t i = 0; i < workers_count + 1; ++i)
+        _queues.push_back(std::make_unique<internal::WorkQueue>());
+
+    _workers.reserve(workers_count);
+    for (size_t i = 0; i < workers_count; ++i)
+        _workers.emplace_back([this, i]() { worker_loop(i); });
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::unique_lock lock{_sleep_mutex};
+        _stop = true;
+    }
+    _wake_up.notify_all();
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+void JobSystem::push(size_t queue_index, internal::JobRange const& range)
+{
+    {
+        std::unique_lock lock{_sleep_mutex}; // Makes sure a worker can't miss the notification between checking _pending_ranges and going to sleep
+        _pending_ranges++;                   // Before the range becomes visible, otherwise a thief could decrement the counter first and wrap it around
+    }
+    {
+        std::unique_lock lock{_queues[queue_index]->mutex};
+        _queues[queue_index]->ranges.push_back(range);
+    }
+    _wake_up.notify_one();
+}
+
+auto JobSystem::try_pop(size_t queue_index, internal::JobRange& range) -> bool
+{
+    auto& queue = *_queues[queue_index];
+    auto  lock  = std::unique_lock{queue.mutex};
+    if (queue.ranges.empty())
+        return false;
+    range = queue.ranges.back(); // Most recently split range, it is the smallest one and its data is probably still in our cache
+    queue.ranges.pop_back();
+    _pending_ranges--;
+    return true;
+}
+
+auto JobSystem::try_steal(size_t thief_index, internal::JobRange& range) -> bool
+{
+    for (size_t offset = 1; offset < _queues.size(); ++offset)
+    {
+        auto& queue = *_queues[(thief_index + offset) % _queues.size()];
+        auto  lock  = std::unique_lock{queue.mutex};
+        if (queue.ranges.empty())
+            continue;
+        range = queue.ranges.front(); // Oldest range, it is the biggest one so stealing it is worth the synchronization cost
+        queue.ranges.pop_front();
+        _pending_ranges--;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::process(size_t queue_index, internal::JobRange range)
+{
+    auto& job = *range.job;
+    // Keep splitting our range in half, and make the second half available to the other threads, until we are left with a single chunk
+    while (range.end - range.begin > job.chunk_size)
+    {
+        auto const chunks_count = (range.end - range.begin + job.chunk_size - 1) / job.chunk_size;
+        auto const middle       = range.begin + chunks_count / 2 * job.chunk_size;
+        push(queue_index, {.job = &job, .begin = middle, .end = range.end});
+        range.end = middle;
+    }
+    (*job.function)(range.begin, range.end);
+    job.remaining_items.fetch_sub(range.end - range.begin, std::memory_order_release); // Must be the last access to `job`, the thread that called parallel_for() might destroy it as soon as this reaches 0
+}
+
+void JobSystem::worker_loop(size_t worker_index)
+{
+    while (true)
+    {
+        internal::JobRange range{};
+        if (try_pop(worker_index, range) || try_steal(worker_index, range))
+        {
+            process(worker_index, range);
+            continue;
+        }
+        auto lock = std::unique_lock{_sleep_mutex};
+        _wake_up.wait(lock, [&]() { return _stop || _pending_ranges > 0; });
+        if (_stop)
+            return;
+    }
+}
+
+void JobSystem::parallel_for(size_t count, size_t chunk_size, std::function<void(size_t begin, size_t end)> const& function)
+{
+    assert(chunk_size > 0);
+    if (count == 0)
+        return;
+    if (count <= chunk_size || _workers.empty())
+    { // Not worth waking up the workers
+        for (size_t begin = 0; begin < count; begin += chunk_size)
+            function(begin, std::min(begin + chunk_size, count));
+        return;
+    }
+
+    auto const queue_index = _queues.size() - 1; // Shared by all the threads that are not workers
+    auto       job         = internal::ParallelForJob{.function = &function, .chunk_size = chunk_size, .remaining_items = count};
+    process(queue_index, {.job = &job, .begin = 0, .end = count});
+
+    // Help the workers instead of just waiting for them
+    while (job.remaining_items.load(std::memory_order_acquire) > 0)
+    {
+        internal::JobRange range{};
+        if (try_pop(queue_index, range) || try_steal(queue_index, range))
+            process(queue_index, range);
+        else
+            std::this_thread::yield();
+    }
+}
+
+auto job_system() -> JobSystem&
+{
+    static auto instance = JobSystem{};
+    return instance;
+}
+
+} // namespace gl
@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gl {
+
+namespace internal {
+struct ParallelForJob {
+    std::function<void(size_t begin, size_t end)> const* function{};
+    size_t                                               chunk_size{};
+    std::atomic<size_t>                                  remaining_items{};
+};
+
+struct JobRange {
+    ParallelForJob* job{};
+    size_t          begin{};
+    size_t          end{};
+};
+
+/// Each worker owns one of these. It pops from the back of its own queue, and other threads steal from the front.
+struct WorkQueue {
+    std::mutex           mutex{};
+    std::deque<JobRange> ranges{};
+};
+} // namespace internal
+
+/// A pool of worker threads that share work through work-stealing queues.
+/// Most of the time you will want to use the shared instance, see gl::job_system().
+class JobSystem {
+public:
+    /// The thread that calls parallel_for() also does some of the work, so by default we create one worker less than the number of hardware threads.
+    explicit JobSystem(size_t workers_count = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    ~JobSystem();
+    JobSystem(JobSystem const&)                    = delete;
+    auto operator=(JobSystem const&) -> JobSystem& = delete;
+    JobSystem(JobSystem&&)                         = delete;
+    auto operator=(JobSystem&&) -> JobSystem&      = delete;
+
+    /// Calls `function(begin, end)` on sub-ranges of [0, count) that cover it entirely, spread across all the threads.
+    /// Every sub-range starts at a multiple of `chunk_size`, and is at most `chunk_size` long.
+    /// Returns once all the sub-ranges have been processed. `function` must be safe to call concurrently on disjoint ranges.
+    void parallel_for(size_t count, size_t chunk_size, std::function<void(size_t begin, size_t end)> const& function);
+
+    auto threads_count() const -> size_t { return _workers.size() + 1; }
+
+private:
+    void worker_loop(size_t worker_index);
+    void push(size_t queue_index, internal::JobRange const&);
+    auto try_pop(size_t queue_index, internal::JobRange& range) -> bool;
+    auto try_steal(size_t thief_index, internal::JobRange& range) -> bool;
+    void process(size_t queue_index, internal::JobRange range);
+
+private:
+    std::vector<std::unique_ptr<internal::WorkQueue>> _queues{}; // One per worker, plus one for the threads that call parallel_for()
+    std::vector<std::thread>                          _workers{};
+    std::mutex                                        _sleep_mutex{};
+    std::condition_variable                           _wake_up{};
+    std::atomic<size_t>                               _pending_ranges{0};
+    bool                                              _stop{false};
+};
+
+/// Shared JobSystem, with a worker for each hardware thread. It is created the first time you call this function.
+auto job_system() -> JobSystem&;
+
+} // namespace gl
@@ -0,0 +1,120 @@
+#include "MappedFile.hpp"
+#include <utility>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gl::internal {
+
+#if defined(_WIN32)
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+    _file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+    {
+        _file = nullptr;
+        return;
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) // Empty files can't be mapped
+    {
+        close();
+        return;
+    }
+    _file_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_file_mapping == nullptr)
+    {
+        close();
+        return;
+    }
+    _data = static_cast<std::byte const*>(MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+        close();
+        return;
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr)
+        UnmapViewOfFile(_data);
+    if (_file_mapping != nullptr)
+        CloseHandle(_file_mapping);
+    if (_file != nullptr)
+        CloseHandle(_file);
+    _data         = nullptr;
+    _size         = 0;
+    _file_mapping = nullptr;
+    _file         = nullptr;
+}
+#else
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+    int const file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return;
+    struct stat status{};
+    if (fstat(file, &status) == 0 && status.st_size > 0) // Empty files can't be mapped
+    {
+        void* const data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+        {
+            _data = static_cast<std::byte const*>(data);
+            _size = static_cast<size_t>(status.st_size);
+        }
+    }
+    ::close(file); // The mapping stays valid after the file is closed
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr)
+        munmap(const_cast<std::byte*>(_data), _size); // NOLINT(*const-cast)
+    _data = nullptr;
+    _size = 0;
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+    : _data{std::exchange(o._data, nullptr)}
+    , _size{std::exchange(o._size, 0)}
+#if defined(_WIN32)
+    , _file{std::exchange(o._file, nullptr)}
+    , _file_mapping{std::exchange(o._file_mapping, nullptr)}
+#endif
+{}
+
+auto MappedFile::operator=(MappedFile&& o) noexcept -> MappedFile&
+{
+    if (this != &o)
+    {
+        close();
+        _data = std::exchange(o._data, nullptr);
+        _size = std::exchange(o._size, 0);
+#if defined(_WIN32)
+        _file         = std::exchange(o._file, nullptr);
+        _file_mapping = std::exchange(o._file_mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+} // namespace gl::internal
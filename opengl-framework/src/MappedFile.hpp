@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace gl::internal {
+
+/// Maps a whole file in memory, read-only. The OS only loads the pages we actually read, and we never have to copy the file into our own buffer.
+class MappedFile {
+public:
+    /// Check is_open() to know if it succeeded. This is not an error, because we use it for caches, where a missing file is expected.
+    explicit MappedFile(std::filesystem::path const& path);
+    ~MappedFile();
+    MappedFile(MappedFile const&)                    = delete;
+    auto operator=(MappedFile const&) -> MappedFile& = delete;
+    MappedFile(MappedFile&&) noexcept;
+    auto operator=(MappedFile&&) noexcept -> MappedFile&;
+
+    auto is_open() const -> bool { return _data != nullptr; }
+    auto bytes() const -> std::span<std::byte const> { return {_data, _size}; }
+
+private:
+    void close();
+
+private:
+    std::byte const* _data{nullptr}; // Page-aligned
+    size_t           _size{0};
+#if defined(_WIN32)
+    void* _file{nullptr};
+    void* _file_mapping{nullptr};
+#endif
+};
+
+} // namespace gl::internal
@@ -1,7 +1,13 @@
 #include "Mesh.hpp"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <numeric>
+#include <type_traits>
 #include <opengl-framework/opengl-framework.hpp>
+#include "extensions.hpp"
+#include "handle_error.hpp"
+#include "quantize_mesh.hpp"
 
 namespace gl {
 
@@ -17,79 +23,355 @@ static auto type(AnyVertexAttribute const& attr)
 {
     return std::visit([](auto&& attr) { return attr.type(); }, attr);
 }
+static auto kind(AnyVertexAttribute const& attr)
+{
+    return std::visit([](auto&& attr) { return attr.kind(); }, attr);
+}
+static auto locations_count(AnyVertexAttribute const& attr)
+{
+    return std::visit([](auto&& attr) { return attr.locations_count(); }, attr);
+}
 static auto size_in_bytes(AnyVertexAttribute const& attr)
 {
-    return size(attr) * 4;
+    return std::visit([](auto&& attr) { return attr.size_in_bytes(); }, attr);
+}
+
+static auto vertex_bytes(VertexBuffer_Descriptor const& desc) -> std::span<std::byte const>
+{
+    assert((desc.data.empty() || desc.bytes.empty()) && "You must provide either data or bytes, not both.");
+    assert((desc.data.empty() || std::all_of(desc.layout.begin(), desc.layout.end(), [](AnyVertexAttribute const& attr) { return type(attr) == GL_FLOAT; })) && "data can only contain 32-bit floats. Use bytes for the other vertex formats.");
+    return !desc.bytes.empty() ? desc.bytes : std::as_bytes(std::span{desc.data});
+}
+
+namespace internal {
+auto smallest_index_type(std::span<uint32_t const> indices) -> IndexType
+{
+    uint32_t const max_index = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+    return max_index < 0xFFFF ? IndexType::UInt16 : IndexType::UInt32; // We keep 0xFFFF free, because it is the index used by primitive restart
+}
+
+auto index_size_in_bytes(IndexType index_type) -> size_t
+{
+    switch (index_type)
+    {
+    case IndexType::UInt8:
+        return sizeof(uint8_t);
+    case IndexType::UInt16:
+        return sizeof(uint16_t);
+    case IndexType::Automatic:
+    case IndexType::UInt32:
+        return sizeof(uint32_t);
+    }
+    return sizeof(uint32_t);
+}
+} // namespace internal
+
+static auto resolve_index_type(IndexType index_type, std::span<uint32_t const> indices) -> IndexType
+{
+    if (index_type == IndexType::Automatic)
+        return internal::smallest_index_type(indices);
+    if (index_type == IndexType::UInt32)
+        return index_type; // No need to look at the indices, they all fit
+#ifndef NDEBUG
+    uint32_t const max_index = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end());
+    assert((index_type != IndexType::UInt8 || max_index <= 0xFF) && "There are too many vertices to use 8-bit indices. Use IndexType::Automatic instead.");
+    assert((index_type != IndexType::UInt16 || max_index <= 0xFFFF) && "There are too many vertices to use 16-bit indices. Use IndexType::Automatic instead.");
+#endif
+    return index_type;
+}
+
+static auto gl_index_type(IndexType index_type) -> GLenum
+{
+    switch (index_type)
+    {
+    case IndexType::UInt8:
+        return GL_UNSIGNED_BYTE;
+    case IndexType::UInt16:
+        return GL_UNSIGNED_SHORT;
+    case IndexType::Automatic:
+    case IndexType::UInt32:
+        return GL_UNSIGNED_INT;
+    }
+    return GL_UNSIGNED_INT;
+}
+
+template<typename Index>
+static void upload_indices(std::span<uint32_t const> indices)
+{
+    if constexpr (std::is_same_v<Index, uint32_t>)
+    {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size_bytes()), indices.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        auto narrow_indices = std::vector<Index>(indices.size());
+        std::transform(indices.begin(), indices.end(), narrow_indices.begin(), [](uint32_t index) { return static_cast<Index>(index); });
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(narrow_indices.size() * sizeof(Index)), narrow_indices.data(), GL_STATIC_DRAW);
+    }
+}
+
+namespace internal {
+void set_vertex_attribute_pointers(std::span<AnyVertexAttribute const> layout, size_t offset_in_bytes, GLuint divisor)
+{
+    auto const stride = vertex_stride(layout);
+    for (auto const& attribute : layout)
+    {
+        auto const column_size_in_bytes = static_cast<size_t>(size_in_bytes(attribute) / locations_count(attribute));
+        for (GLint column = 0; column < locations_count(attribute); ++column) // Matrices take one location per column
+        {
+            auto const location = static_cast<GLuint>(index(attribute) + column);
+            auto const pointer  = reinterpret_cast<void const*>(offset_in_bytes); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+            glEnableVertexAttribArray(location);
+            if (kind(attribute) == VertexAttributeKind::Integer) // glVertexAttribPointer() would convert them to floats
+                glVertexAttribIPointer(location, size(attribute), type(attribute), stride, pointer);
+            else
+                glVertexAttribPointer(location, size(attribute), type(attribute), kind(attribute) == VertexAttributeKind::Normalized ? GL_TRUE : GL_FALSE, stride, pointer);
+            glVertexAttribDivisor(location, divisor);
+            offset_in_bytes += column_size_in_bytes;
+        }
+    }
+}
+
+auto vertex_stride(std::span<AnyVertexAttribute const> layout) -> GLsizei
+{
+    return std::accumulate(layout.begin(), layout.end(), 0, [](int acc, AnyVertexAttribute const& attr) {
+        return acc + size_in_bytes(attr);
+    });
+}
+} // namespace internal
+
+/// The bounds of the attribute at location 0, if `layout` has one and it is made of floats or half floats.
+static auto positions_bounds(std::span<AnyVertexAttribute const> layout, std::span<std::byte const> vertices) -> std::optional<Bounds>
+{
+    auto const stride         = static_cast<size_t>(internal::vertex_stride(layout));
+    auto const vertices_count = stride == 0 ? 0 : vertices.size() / stride;
+    size_t     offset         = 0;
+    for (auto const& attribute : layout)
+    {
+        if (index(attribute) == 0 && vertices_count != 0)
+        {
+            auto const bounds = [&]<typename Attribute>(Attribute const&) -> std::optional<Bounds> {
+                constexpr auto components_count = static_cast<size_t>(std::min(Attribute::size(), 3)); // The 4th component is usually just a 1
+                if constexpr (Attribute::locations_count() == 1 && Attribute::type() == GL_FLOAT)
+                {
+                    return compute_bounds(vertices.subspan(offset), vertices_count, stride, [](std::byte const* vertex) {
+                        auto res = glm::vec3{0.f};
+                        std::memcpy(&res, vertex, components_count * sizeof(float));
+                        return res;
+                    });
+                }
+                else if constexpr (Attribute::type() == GL_HALF_FLOAT)
+                {
+                    return compute_bounds(vertices.subspan(offset), vertices_count, stride, [](std::byte const* vertex) {
+                        auto halves = std::array<uint16_t, 3>{};
+                        std::memcpy(halves.data(), vertex, components_count * sizeof(uint16_t));
+                        auto res = glm::vec3{0.f};
+                        for (size_t i = 0; i < components_count; ++i)
+                            res[static_cast<glm::length_t>(i)] = internal::half_to_float(halves[i]);
+                        return res;
+                    });
+                }
+                else
+                {
+                    return std::nullopt;
+                }
+            };
+            return std::visit(bounds, attribute);
+        }
+        offset += static_cast<size_t>(size_in_bytes(attribute));
+    }
+    return std::nullopt;
 }
 
 Mesh::Mesh(Mesh_Descriptor desc)
 {
     assert(!desc.vertex_buffers.empty() && "You must provide at least one vertex buffer to construct a mesh.");
+    assert((int{!desc.index_buffer.empty()} + int{!desc.index_buffer_view.empty()} + int{!desc.index_buffer_bytes.empty()} <= 1) && "You must provide only one of index_buffer, index_buffer_view and index_buffer_bytes.");
+    assert((desc.index_buffer_bytes.empty() || desc.index_type != IndexType::Automatic) && "You must tell the type of the indices in index_buffer_bytes.");
+    auto const index_buffer  = !desc.index_buffer_view.empty() ? desc.index_buffer_view : std::span{desc.index_buffer};
+    auto const indices_count = !desc.index_buffer_bytes.empty() ? desc.index_buffer_bytes.size() / internal::index_size_in_bytes(desc.index_type) : index_buffer.size();
 
-    if (!desc.index_buffer.empty())
+    if (indices_count != 0)
     {
-        assert(desc.index_buffer.size() % 3 == 0 && "You must provide 3 indices for each triangle");
-        _triangles_count = desc.index_buffer.size() / 3;
+        assert(indices_count % 3 == 0 && "You must provide 3 indices for each triangle");
+        _triangles_count = indices_count / 3;
     }
 
     { // Vertex Array
         glGenVertexArrays(1, &_vertex_array);
-        glBindVertexArray(_vertex_array);
+        state_cache().bind_vertex_array(_vertex_array);
     }
 
     { // Vertex Buffers
         _vertex_buffers.resize(desc.vertex_buffers.size());
-        glGenBuffers(static_cast<int>(_vertex_buffers.size()), _vertex_buffers.data());
+        bool is_first_per_vertex_buffer = true;
         for (size_t i = 0; i < _vertex_buffers.size(); ++i)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffers[i]);
-            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(desc.vertex_buffers[i].data.size() * sizeof(GLfloat)), desc.vertex_buffers[i].data.data(), GL_STATIC_DRAW);
+            auto const& buffer_desc = desc.vertex_buffers[i];
+            auto&       buffer      = _vertex_buffers[i];
+            auto const  bytes       = vertex_bytes(buffer_desc);
+            assert((buffer_desc.capacity_in_bytes == 0 || buffer_desc.capacity_in_bytes >= bytes.size()) && "The capacity of the buffer must be big enough to hold its initial data.");
+
+            buffer.stride            = internal::vertex_stride(buffer_desc.layout);
+            buffer.capacity_in_bytes = std::max(buffer_desc.capacity_in_bytes, bytes.size());
+            buffer.usage             = buffer_desc.persistently_mapped ? BufferUsage::Stream : buffer_desc.usage;
+
+            glGenBuffers(1, &buffer.id);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id); // GL_COPY_WRITE_BUFFER is not used by any draw call, so binding to it doesn't mess with the state of the rest of the app
+            if (buffer_desc.persistently_mapped && internal::extensions().buffer_storage)
+            {
+                // Rounded up so that each region starts on a nicely aligned address
+                buffer.region_size_in_bytes = (buffer.capacity_in_bytes + 255) / 256 * 256;
+                auto const size             = static_cast<GLsizeiptr>(buffer.region_size_in_bytes * persistent_regions_count);
+                GLbitfield const flags      = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                internal::extensions().glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+                buffer.mapping = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+                if (buffer.mapping == nullptr)
+                    handle_error("[Mesh] Failed to map a vertex buffer.");
+                for (size_t region = 0; region < persistent_regions_count; ++region)
+                    std::copy(bytes.begin(), bytes.end(), buffer.mapping + region * buffer.region_size_in_bytes); // NOLINT(*pointer-arithmetic)
+            }
+            else
+            {
+                glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(buffer.capacity_in_bytes), nullptr, static_cast<GLenum>(buffer.usage));
+                glBufferSubData(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(bytes.size()), bytes.data());
+            }
 
-            int const stride = std::accumulate(desc.vertex_buffers[i].layout.begin(), desc.vertex_buffers[i].layout.end(), 0, [](int acc, AnyVertexAttribute const& attr) {
-                return acc + size_in_bytes(attr);
-            });
-            if (desc.index_buffer.empty())
+            if (indices_count == 0 && buffer_desc.divisor == 0) // Per-instance buffers don't tell us anything about the number of vertices
             {
-                auto const triangles_count = desc.vertex_buffers[i].data.size() / (stride / sizeof(float)) / 3;
-                if (i == 0)
+                auto const triangles_count = bytes.size() / static_cast<size_t>(buffer.stride) / 3;
+                if (is_first_per_vertex_buffer)
                     _triangles_count = triangles_count;
                 else
                     assert(_triangles_count == triangles_count && "Some vertex buffers contain more vertices than others! Make sure that their data is correct, and that the layout matches the data.");
+                is_first_per_vertex_buffer = false;
             }
-            uint64_t pointer{0};
-            for (auto const& attribute : desc.vertex_buffers[i].layout)
+            if (buffer_desc.divisor == 0 && !_bounds.has_value())
+                _bounds = positions_bounds(buffer_desc.layout, bytes);
+
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+            internal::set_vertex_attribute_pointers(buffer_desc.layout, 0, buffer_desc.divisor);
+            if (buffer.mapping != nullptr) // To point to another region later on
             {
-                glEnableVertexAttribArray(index(attribute));
-                glVertexAttribPointer(index(attribute), size(attribute), type(attribute), GL_FALSE, stride, reinterpret_cast<void*>(pointer)); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
-                pointer += size_in_bytes(attribute);
+                buffer.layout  = buffer_desc.layout;
+                buffer.divisor = buffer_desc.divisor;
             }
         }
     }
 
     { // Index Buffer
-        if (!desc.index_buffer.empty())
+        if (!desc.index_buffer_bytes.empty())
+        {
+            _index_type = gl_index_type(desc.index_type);
+            glGenBuffers(1, &_maybe_index_buffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _maybe_index_buffer);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(desc.index_buffer_bytes.size()), desc.index_buffer_bytes.data(), GL_STATIC_DRAW);
+        }
+        else if (!index_buffer.empty())
         {
+            auto const index_type = resolve_index_type(desc.index_type, index_buffer);
+            _index_type           = gl_index_type(index_type);
             glGenBuffers(1, &_maybe_index_buffer);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _maybe_index_buffer);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(desc.index_buffer.size() * sizeof(uint32_t)), desc.index_buffer.data(), GL_STATIC_DRAW);
+            if (index_type == IndexType::UInt8)
+                upload_indices<uint8_t>(index_buffer);
+            else if (index_type == IndexType::UInt16)
+                upload_indices<uint16_t>(index_buffer);
+            else
+                upload_indices<uint32_t>(index_buffer);
         }
     }
 }
 
 void Mesh::draw() const
 {
-    glBindVertexArray(_vertex_array);
+    draw_instanced(1);
+}
+
+void Mesh::draw_instanced(size_t instances_count) const
+{
+    _draws_count++;
+    state_cache().bind_vertex_array(_vertex_array);
     if (_maybe_index_buffer != 0)
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(3 * _triangles_count), GL_UNSIGNED_INT, reinterpret_cast<void*>(0)); // NOLINT(*reinterpret-cast)
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(3 * _triangles_count), _index_type, reinterpret_cast<void*>(0), static_cast<GLsizei>(instances_count)); // NOLINT(*reinterpret-cast)
     else
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(3 * _triangles_count));
+        glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(3 * _triangles_count), static_cast<GLsizei>(instances_count));
+}
+
+static void wait_for_fence(GLsync& fence)
+{
+    if (fence == nullptr)
+        return;
+    // Typically already signaled, unless the CPU is more than persistent_regions_count frames ahead of the GPU
+    GLenum result = GL_TIMEOUT_EXPIRED;
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000 /*nanoseconds*/);
+    if (result == GL_WAIT_FAILED)
+        handle_error("[Mesh] Failed to wait for the GPU to be done with a vertex buffer.");
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void Mesh::update_vertex_buffer(size_t index, std::span<std::byte const> data, size_t offset_in_bytes)
+{
+    assert(index < _vertex_buffers.size() && "There is no vertex buffer at this index.");
+    auto& buffer = _vertex_buffers[index];
+    assert(offset_in_bytes + data.size() <= buffer.capacity_in_bytes && "The data doesn't fit in the buffer. You can make it bigger with VertexBuffer_Descriptor::capacity_in_bytes.");
+
+    bool const gpu_might_be_using_it  = buffer.draws_count_at_last_update != _draws_count;
+    buffer.draws_count_at_last_update = _draws_count;
+
+    if (buffer.mapping != nullptr)
+    {
+        update_persistently_mapped_buffer(index, data, offset_in_bytes, gpu_might_be_using_it);
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id);
+    if (buffer.usage == BufferUsage::Stream && gpu_might_be_using_it)
+    {
+        // Orphaning: the driver gives us new memory right away, and frees the old one once the GPU is done with it, instead of making us wait
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(buffer.capacity_in_bytes), nullptr, static_cast<GLenum>(buffer.usage));
+    }
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset_in_bytes), static_cast<GLsizeiptr>(data.size()), data.data());
+}
+
+void Mesh::update_persistently_mapped_buffer(size_t index, std::span<std::byte const> data, size_t offset_in_bytes, bool gpu_might_be_using_it)
+{
+    auto& buffer = _vertex_buffers[index];
+    if (gpu_might_be_using_it)
+    {
+        // Move on to the next region, and let the GPU finish reading the current one
+        buffer.fences[buffer.current_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        buffer.current_region                = (buffer.current_region + 1) % persistent_regions_count;
+        wait_for_fence(buffer.fences[buffer.current_region]);
+
+        state_cache().bind_vertex_array(_vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+        internal::set_vertex_attribute_pointers(buffer.layout, buffer.current_region * buffer.region_size_in_bytes, buffer.divisor);
+    }
+    // The mapping is coherent, so the GPU will see the data without us having to flush anything
+    std::copy(data.begin(), data.end(), buffer.mapping + buffer.current_region * buffer.region_size_in_bytes + offset_in_bytes); // NOLINT(*pointer-arithmetic)
+}
+
+void Mesh::delete_vertex_buffers()
+{
+    for (auto& buffer : _vertex_buffers) // Deleting a mapped buffer also unmaps it
+    {
+        glDeleteBuffers(1, &buffer.id);
+        for (GLsync fence : buffer.fences)
+        {
+            if (fence != nullptr)
+                glDeleteSync(fence);
+        }
+    }
+    _vertex_buffers.clear();
 }
 
 Mesh::~Mesh()
 {
+    state_cache().forget_vertex_array(_vertex_array);
     glDeleteVertexArrays(1, &_vertex_array);
-    if (!_vertex_buffers.empty()) // Might have been moved-from
-        glDeleteBuffers(static_cast<int>(_vertex_buffers.size()), _vertex_buffers.data());
+    delete_vertex_buffers(); // Does nothing if we have been moved-from
     glDeleteBuffers(1, &_maybe_index_buffer);
 }
 
@@ -97,7 +379,10 @@ Mesh::Mesh(Mesh&& o) noexcept
     : _vertex_array{o._vertex_array}
     , _vertex_buffers{std::move(o._vertex_buffers)}
     , _maybe_index_buffer{o._maybe_index_buffer}
+    , _index_type{o._index_type}
     , _triangles_count{o._triangles_count}
+    , _draws_count{o._draws_count}
+    , _bounds{o._bounds}
 {
     o._vertex_array = 0;
     o._vertex_buffers.resize(0);
@@ -109,16 +394,19 @@ auto Mesh::operator=(Mesh&& o) noexcept -> Mesh&
     if (this != &o)
     {
         // Delete this
+        state_cache().forget_vertex_array(_vertex_array);
         glDeleteVertexArrays(1, &_vertex_array);
-        if (!_vertex_buffers.empty()) // Might have been moved-from
-            glDeleteBuffers(static_cast<int>(_vertex_buffers.size()), _vertex_buffers.data());
+        delete_vertex_buffers();
         glDeleteBuffers(1, &_maybe_index_buffer);
 
         // Move
         _vertex_array       = o._vertex_array;
         _vertex_buffers     = std::move(o._vertex_buffers);
         _maybe_index_buffer = o._maybe_index_buffer;
+        _index_type         = o._index_type;
         _triangles_count    = o._triangles_count;
+        _draws_count        = o._draws_count;
+        _bounds             = o._bounds;
 
         o._vertex_array = 0;
         o._vertex_buffers.resize(0);
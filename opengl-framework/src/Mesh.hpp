@@ -1,6 +1,13 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
 #include <variant>
 #include <vector>
+#include "Bounds.hpp"
+#include "Buffer.hpp"
 #include "glad/gl.h"
 
 namespace gl {
@@ -19,62 +26,75 @@ private:
 };
 } // namespace internal
 
-namespace VertexAttribute {
-class Float : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 1; }
-    static auto type() -> GLenum { return GL_FLOAT; }
-};
-class Vec2 : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 2; }
-    static auto type() -> GLenum { return GL_FLOAT; }
-};
-class Vec3 : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 3; }
-    static auto type() -> GLenum { return GL_FLOAT; }
-};
-class Vec4 : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 4; }
-    static auto type() -> GLenum { return GL_FLOAT; }
-};
-class Int : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 1; }
-    static auto type() -> GLenum { return GL_INT; }
-};
-class IVec2 : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 2; }
-    static auto type() -> GLenum { return GL_INT; }
-};
-class IVec3 : public internal::VertexAttribute_Base {
-public:
-    using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 3; }
-    static auto type() -> GLenum { return GL_INT; }
+namespace internal {
+/// How the shader sees the values stored in the vertex buffer.
+enum class VertexAttributeKind {
+    Float,      // Floating-point values (32-bit or half floats)
+    Normalized, // Integers mapped to [0, 1] if they are unsigned, or [-1, 1] if they are signed (e.g. 255 becomes 1.f for an unsigned byte). Read as a float / vec in the shader.
+    Integer,    // Integers, read as an int / ivec in the shader
 };
-class IVec4 : public internal::VertexAttribute_Base {
+
+/// `Size` is the number of components in each location. Matrices take one location per column.
+template<GLint Size, GLenum Type, VertexAttributeKind Kind, GLint LocationsCount = 1>
+class VertexAttribute_Typed : public VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
-    static auto size() -> GLint { return 4; }
-    static auto type() -> GLenum { return GL_INT; }
+    static constexpr auto size() -> GLint { return Size; }
+    static constexpr auto type() -> GLenum { return Type; }
+    static constexpr auto kind() -> VertexAttributeKind { return Kind; }
+    static constexpr auto locations_count() -> GLint { return LocationsCount; }
+    static constexpr auto size_in_bytes() -> GLint
+    {
+        if constexpr (Type == GL_INT_2_10_10_10_REV || Type == GL_UNSIGNED_INT_2_10_10_10_REV)
+            return 4 * LocationsCount; // The 4 components are packed in a single 32-bit integer
+        else if constexpr (Type == GL_BYTE || Type == GL_UNSIGNED_BYTE)
+            return Size * LocationsCount;
+        else if constexpr (Type == GL_SHORT || Type == GL_UNSIGNED_SHORT || Type == GL_HALF_FLOAT)
+            return 2 * Size * LocationsCount;
+        else
+            return 4 * Size * LocationsCount;
+    }
 };
+} // namespace internal
+
+namespace VertexAttribute {
+using Float = internal::VertexAttribute_Typed<1, GL_FLOAT, internal::VertexAttributeKind::Float>;
+using Vec2  = internal::VertexAttribute_Typed<2, GL_FLOAT, internal::VertexAttributeKind::Float>;
+using Vec3  = internal::VertexAttribute_Typed<3, GL_FLOAT, internal::VertexAttributeKind::Float>;
+using Vec4  = internal::VertexAttribute_Typed<4, GL_FLOAT, internal::VertexAttributeKind::Float>;
+using Int   = internal::VertexAttribute_Typed<1, GL_INT, internal::VertexAttributeKind::Integer>;
+using IVec2 = internal::VertexAttribute_Typed<2, GL_INT, internal::VertexAttributeKind::Integer>;
+using IVec3 = internal::VertexAttribute_Typed<3, GL_INT, internal::VertexAttributeKind::Integer>;
+using IVec4 = internal::VertexAttribute_Typed<4, GL_INT, internal::VertexAttributeKind::Integer>;
+
+// Matrices take one location per column: a Mat4 at location 3 is also at locations 4, 5 and 6, so your next attribute must be at location 7.
+// They are typically used for per-instance transforms (see VertexBuffer_Descriptor::divisor).
+using Mat3 = internal::VertexAttribute_Typed<3, GL_FLOAT, internal::VertexAttributeKind::Float, 3>;
+using Mat4 = internal::VertexAttribute_Typed<4, GL_FLOAT, internal::VertexAttributeKind::Float, 4>;
+
+// Compact formats, that use less memory and bandwidth than 32-bit floats. They are still read as a float / vec in the shader.
+// There are no 3-component versions of the 8 and 16-bit formats, because GPUs want each attribute to start on a multiple of 4 bytes: use the 4-component version, and ignore the last component.
+using HalfVec2         = internal::VertexAttribute_Typed<2, GL_HALF_FLOAT, internal::VertexAttributeKind::Float>;
+using HalfVec4         = internal::VertexAttribute_Typed<4, GL_HALF_FLOAT, internal::VertexAttributeKind::Float>;
+using UNorm8Vec4       = internal::VertexAttribute_Typed<4, GL_UNSIGNED_BYTE, internal::VertexAttributeKind::Normalized>;
+using SNorm8Vec4       = internal::VertexAttribute_Typed<4, GL_BYTE, internal::VertexAttributeKind::Normalized>;
+using UNorm16Vec2      = internal::VertexAttribute_Typed<2, GL_UNSIGNED_SHORT, internal::VertexAttributeKind::Normalized>;
+using UNorm16Vec4      = internal::VertexAttribute_Typed<4, GL_UNSIGNED_SHORT, internal::VertexAttributeKind::Normalized>;
+using SNorm16Vec2      = internal::VertexAttribute_Typed<2, GL_SHORT, internal::VertexAttributeKind::Normalized>;
+using SNorm16Vec4      = internal::VertexAttribute_Typed<4, GL_SHORT, internal::VertexAttributeKind::Normalized>;
+using UNorm_2_10_10_10 = internal::VertexAttribute_Typed<4, GL_UNSIGNED_INT_2_10_10_10_REV, internal::VertexAttributeKind::Normalized>; // x, y and z on 10 bits, w on 2 bits
+using SNorm_2_10_10_10 = internal::VertexAttribute_Typed<4, GL_INT_2_10_10_10_REV, internal::VertexAttributeKind::Normalized>;          // x, y and z on 10 bits, w on 2 bits
 
-using Position2D = Vec2;
-using Position3D = Vec3;
-using Normal3D   = Vec3;
-using UV         = Vec2;
-using ColorRGB   = Vec3;
-using ColorRGBA  = Vec4;
+using Position2D     = Vec2;
+using Position3D     = Vec3;
+using Normal3D       = Vec3;
+using UV             = Vec2;
+using ColorRGB       = Vec3;
+using ColorRGBA      = Vec4;
+using HalfPosition3D = HalfVec4;         // The 4th component is ignored by a vec3 in the shader
+using PackedNormal3D = SNorm_2_10_10_10; // 4 bytes instead of 12, and plenty precise for lighting
+using HalfUV         = HalfVec2;
+using ColorRGBA8     = UNorm8Vec4;
 } // namespace VertexAttribute
 
 using AnyVertexAttribute = std::variant<
@@ -85,16 +105,62 @@ using AnyVertexAttribute = std::variant<
     VertexAttribute::Int,
     VertexAttribute::IVec2,
     VertexAttribute::IVec3,
-    VertexAttribute::IVec4>;
+    VertexAttribute::IVec4,
+    VertexAttribute::HalfVec2,
+    VertexAttribute::HalfVec4,
+    VertexAttribute::UNorm8Vec4,
+    VertexAttribute::SNorm8Vec4,
+    VertexAttribute::UNorm16Vec2,
+    VertexAttribute::UNorm16Vec4,
+    VertexAttribute::SNorm16Vec2,
+    VertexAttribute::SNorm16Vec4,
+    VertexAttribute::UNorm_2_10_10_10,
+    VertexAttribute::SNorm_2_10_10_10,
+    VertexAttribute::Mat3,
+    VertexAttribute::Mat4>;
 
 struct VertexBuffer_Descriptor {
-    std::vector<AnyVertexAttribute> const& layout; // NOLINT(*avoid-const-or-ref-data-members)
-    std::vector<float> const&              data;   // NOLINT(*avoid-const-or-ref-data-members)
+    std::vector<AnyVertexAttribute> const& layout;  // NOLINT(*avoid-const-or-ref-data-members)
+    std::vector<float> const&              data{};  // NOLINT(*avoid-const-or-ref-data-members) Only for layouts where all the attributes are 32-bit floats. Use `bytes` for the other formats.
+    std::span<std::byte const>             bytes{}; // Alternative to `data`, for vertices that are not in a std::vector (e.g. a memory-mapped file), or that use compact formats (e.g. VertexAttribute::HalfVec2). Uploaded as-is, so they must already be laid out as described by `layout`.
+    /// How often you will modify the vertices with Mesh::update_vertex_buffer().
+    BufferUsage usage{BufferUsage::Static};
+    /// Only for buffers that you rewrite every frame. Instead of asking the driver for new memory on each update, the buffer is mapped once and split in 3 regions that are used in turn, so that we never write to the region that the GPU is reading from.
+    /// Requires GL_ARB_buffer_storage (or OpenGL 4.4). Falls back to BufferUsage::Stream when it is not available.
+    bool   persistently_mapped{false};
+    size_t capacity_in_bytes{}; // The size of the buffer. Defaults to the size of the initial data, but can be bigger if you will later update the buffer with more data.
+    /// 0 means that the buffer contains one element per vertex. Otherwise it contains per-instance attributes, and the shader moves on to the next element every `divisor` instances (see Mesh::draw_instanced()).
+    GLuint divisor{0};
+};
+
+namespace internal {
+/// Describes the attributes of `layout` to the currently bound vertex array, and reads them from the buffer currently bound to GL_ARRAY_BUFFER, starting at `offset_in_bytes`.
+void set_vertex_attribute_pointers(std::span<AnyVertexAttribute const> layout, size_t offset_in_bytes, GLuint divisor);
+/// The size of one vertex, in bytes.
+auto vertex_stride(std::span<AnyVertexAttribute const> layout) -> GLsizei;
+} // namespace internal
+
+/// The type of the indices in the index buffer on the GPU. Smaller indices use less memory and bandwidth.
+enum class IndexType {
+    Automatic, // The smallest of UInt16 and UInt32 that can index all the vertices
+    UInt8,     // Up to 256 vertices. Never chosen automatically, because many GPUs don't support it natively and the driver converts the indices to 16-bit, which costs more than it saves.
+    UInt16,    // Up to 65536 vertices
+    UInt32,
 };
 
+namespace internal {
+/// The type that IndexType::Automatic picks for these indices.
+auto smallest_index_type(std::span<uint32_t const> indices) -> IndexType;
+auto index_size_in_bytes(IndexType) -> size_t;
+} // namespace internal
+
 struct Mesh_Descriptor {
     std::vector<VertexBuffer_Descriptor> const& vertex_buffers; // NOLINT(*avoid-const-or-ref-data-members)
     std::vector<uint32_t> const&                index_buffer{};
+    std::span<uint32_t const>                   index_buffer_view{}; // Alternative to `index_buffer`, for indices that are not in a std::vector (e.g. a memory-mapped file)
+    /// Alternative to `index_buffer`, for indices that are already stored as `index_type` (which can't be Automatic then). They are uploaded as is, without even being read on the CPU (e.g. straight from a memory-mapped file).
+    std::span<std::byte const> index_buffer_bytes{};
+    IndexType                  index_type{IndexType::Automatic}; // `index_buffer` and `index_buffer_view` are converted to this type before being uploaded
 };
 
 class Mesh {
@@ -107,13 +173,54 @@ public:
     auto operator=(Mesh&&) noexcept -> Mesh&;
 
     void draw() const;
+    /// Draws the mesh `instances_count` times in a single draw call. Use gl_InstanceID, or vertex buffers with a divisor (see VertexBuffer_Descriptor::divisor), to give each instance its own position, color, etc.
+    void draw_instanced(size_t instances_count) const;
+
+    /// The bounds of the positions, which are the attribute at location 0 (of a vertex buffer without divisor). Computed when the mesh is created.
+    /// nullopt if there is no such attribute, or if it is not made of floats or half floats. It is not updated by update_vertex_buffer().
+    auto bounds() const -> std::optional<Bounds> const& { return _bounds; }
+
+    /// Overwrites part of the vertex buffer at `index` (in the order of Mesh_Descriptor::vertex_buffers). The data must fit in the buffer (see VertexBuffer_Descriptor::capacity_in_bytes).
+    /// With BufferUsage::Stream and persistently mapped buffers, the first update after a draw gives you a new buffer, so that we don't have to wait for the GPU to be done with the old one.
+    /// This means that you must rewrite all the vertices that you will draw, the others are undefined. With BufferUsage::Static and BufferUsage::Dynamic, the rest of the buffer is preserved.
+    void update_vertex_buffer(size_t index, std::span<std::byte const> data, size_t offset_in_bytes = 0);
+    template<typename T>
+    void update_vertex_buffer(size_t index, std::span<T> data, size_t offset_in_bytes = 0)
+    {
+        update_vertex_buffer(index, std::as_bytes(data), offset_in_bytes);
+    }
+
+private:
+    static constexpr size_t persistent_regions_count = 3;
+
+    struct VertexBuffer {
+        GLuint      id{};
+        GLsizei     stride{};
+        size_t      capacity_in_bytes{};
+        BufferUsage usage{};
+        uint64_t    draws_count_at_last_update{}; // If the mesh has been drawn since, the GPU might still be reading the buffer
+
+        // Only for persistently mapped buffers
+        std::vector<AnyVertexAttribute>              layout{}; // To re-specify the attribute pointers when we move on to another region
+        GLuint                                       divisor{};
+        std::byte*                                   mapping{};
+        size_t                                       region_size_in_bytes{};
+        size_t                                       current_region{};
+        std::array<GLsync, persistent_regions_count> fences{}; // Signaled when the GPU is done with the draws that used each region
+    };
+
+    void update_persistently_mapped_buffer(size_t index, std::span<std::byte const> data, size_t offset_in_bytes, bool gpu_might_be_using_it);
+    void delete_vertex_buffers();
 
 private:
-    GLuint              _vertex_array{};
-    std::vector<GLuint> _vertex_buffers{};
-    GLuint              _maybe_index_buffer{};
+    GLuint                    _vertex_array{};
+    std::vector<VertexBuffer> _vertex_buffers{};
+    GLuint                    _maybe_index_buffer{};
+    GLenum                    _index_type{GL_UNSIGNED_INT};
 
-    size_t _triangles_count{};
+    size_t                _triangles_count{};
+    mutable uint64_t      _draws_count{};
+    std::optional<Bounds> _bounds{};
 };
 
 } // namespace gl
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "MeshCache.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <utility>
+#include <variant>
+#include "Hasher.hpp"
+#include "exe_path/exe_path.h"
+
+namespace gl::internal {
+
+namespace {
+
+constexpr uint32_t file_magic_number = 0x534D5247; // "GRMS"
+/// Must be incremented whenever the layout of the file changes, or the way we import meshes changes (e.g. vertices are ordered differently), so that we don't load outdated meshes.
+constexpr uint32_t file_format_version  = 2;
+constexpr size_t   max_attributes_count = 16;
+constexpr size_t   blob_alignment       = 64; // The vertices and indices start on a cache line
+
+struct SerializedAttribute {
+    uint32_t type{};     // Index of the type in AnyVertexAttribute
+    int32_t  location{}; // The index() of the attribute
+};
+
+/// The file is this header, followed by the vertices and the indices, each aligned on `blob_alignment` bytes.
+/// It is only ever read back by the same app on the same machine, so we don't care about endianness.
+struct MeshFileHeader {
+    uint32_t                                              magic_number{file_magic_number};
+    uint32_t                                              format_version{file_format_version};
+    uint64_t                                              key{};
+    uint64_t                                              vertices_offset{};
+    uint64_t                                              vertices_size_in_bytes{};
+    uint64_t                                              indices_offset{};
+    uint64_t                                              indices_count{};
+    uint32_t                                              index_size_in_bytes{};
+    uint32_t                                              attributes_count{};
+    std::array<SerializedAttribute, max_attributes_count> attributes{};
+};
+
+auto align_up(uint64_t offset) -> uint64_t
+{
+    return (offset + blob_alignment - 1) / blob_alignment * blob_alignment;
+}
+
+template<size_t... Is>
+auto make_vertex_attribute(size_t type, int location, std::index_sequence<Is...>) -> AnyVertexAttribute
+{
+    auto res    = AnyVertexAttribute{VertexAttribute::Float{location}};
+    std::ignore = ((type == Is ? (res = std::variant_alternative_t<Is, AnyVertexAttribute>{location}, true) : false) || ...);
+    return res;
+}
+
+auto cache_folder() -> std::filesystem::path
+{
+    return exe_path::user_data() / "opengl-framework" / "mesh-cache" / exe_path::exe().stem();
+}
+
+auto cache_file(uint64_t key) -> std::filesystem::path
+{
+    return cache_folder() / std::format("{:016x}.mesh", key);
+}
+
+} // namespace
+
+auto mesh_cache_key(std::filesystem::path const& source_file) -> uint64_t
+{
+    auto hasher = Hasher{};
+    auto error  = std::error_code{};
+    hasher.add(source_file.lexically_normal().string());
+    hasher.add(static_cast<uint64_t>(std::filesystem::file_size(source_file, error)));
+    hasher.add(static_cast<uint64_t>(std::filesystem::last_write_time(source_file, error).time_since_epoch().count()));
+    hasher.add(uint64_t{file_format_version});
+    return hasher.hash();
+}
+
+auto load_cached_mesh(uint64_t key) -> std::optional<CachedMesh>
+{
+    auto file = MappedFile{cache_file(key)};
+    if (!file.is_open() || file.bytes().size() < sizeof(MeshFileHeader))
+        return std::nullopt;
+
+    auto header = MeshFileHeader{};
+    std::memcpy(&header, file.bytes().data(), sizeof(header));
+    auto const file_size  = file.bytes().size();
+    auto const index_type = header.index_size_in_bytes == sizeof(uint16_t) ? IndexType::UInt16 : IndexType::UInt32;
+    if (header.magic_number != file_magic_number
+        || header.format_version != file_format_version
+        || header.key != key
+        || header.attributes_count > max_attributes_count
+        || header.vertices_offset % blob_alignment != 0
+        || header.indices_offset % blob_alignment != 0
+        || header.vertices_offset > file_size || header.vertices_size_in_bytes > file_size - header.vertices_offset
+        || (header.index_size_in_bytes != sizeof(uint16_t) && header.index_size_in_bytes != sizeof(uint32_t))
+        || header.indices_offset > file_size || header.indices_count > (file_size - header.indices_offset) / header.index_size_in_bytes)
+    {
+        return std::nullopt; // Probably written by an older version of the app, or only partially written
+    }
+
+    auto res = CachedMesh{.file = std::move(file), .index_type = index_type};
+    for (uint32_t i = 0; i < header.attributes_count; ++i)
+    {
+        auto const& attribute = header.attributes[i];
+        if (attribute.type >= std::variant_size_v<AnyVertexAttribute>)
+            return std::nullopt;
+        res.layout.push_back(make_vertex_attribute(attribute.type, attribute.location, std::make_index_sequence<std::variant_size_v<AnyVertexAttribute>>{}));
+    }
+    auto const bytes = res.file.bytes();
+    res.vertices     = bytes.subspan(header.vertices_offset, header.vertices_size_in_bytes);
+    res.indices      = bytes.subspan(header.indices_offset, header.indices_count * header.index_size_in_bytes);
+    return res;
+}
+
+auto indices_as_uint32(CachedMesh const& mesh) -> std::vector<uint32_t>
+{
+    // The mapping is page-aligned and the offset is a multiple of blob_alignment, so the indices are properly aligned
+    if (mesh.index_type == IndexType::UInt16)
+    {
+        auto const indices = std::span{reinterpret_cast<uint16_t const*>(mesh.indices.data()), mesh.indices.size() / sizeof(uint16_t)}; // NOLINT(*reinterpret-cast)
+        return {indices.begin(), indices.end()};
+    }
+    auto const indices = std::span{reinterpret_cast<uint32_t const*>(mesh.indices.data()), mesh.indices.size() / sizeof(uint32_t)}; // NOLINT(*reinterpret-cast)
+    return {indices.begin(), indices.end()};
+}
+
+void save_cached_mesh(uint64_t key, std::span<AnyVertexAttribute const> layout, std::span<std::byte const> vertices, std::span<uint32_t const> indices)
+{
+    if (layout.size() > max_attributes_count)
+        return;
+
+    // Narrowed once here, instead of each time the mesh is loaded
+    auto const index_type     = smallest_index_type(indices);
+    auto       narrow_indices = std::vector<uint16_t>{};
+    if (index_type == IndexType::UInt16)
+    {
+        narrow_indices.resize(indices.size());
+        std::transform(indices.begin(), indices.end(), narrow_indices.begin(), [](uint32_t index) { return static_cast<uint16_t>(index); });
+    }
+    auto const index_bytes = index_type == IndexType::UInt16 ? std::as_bytes(std::span{narrow_indices}) : std::as_bytes(indices);
+
+    auto header = MeshFileHeader{
+        .key                    = key,
+        .vertices_offset        = align_up(sizeof(MeshFileHeader)),
+        .vertices_size_in_bytes = vertices.size(),
+        .indices_count          = indices.size(),
+        .index_size_in_bytes    = static_cast<uint32_t>(index_size_in_bytes(index_type)),
+        .attributes_count       = static_cast<uint32_t>(layout.size()),
+    };
+    header.indices_offset = align_up(header.vertices_offset + header.vertices_size_in_bytes);
+    for (size_t i = 0; i < layout.size(); ++i)
+    {
+        header.attributes[i] = {
+            .type     = static_cast<uint32_t>(layout[i].index()),
+            .location = std::visit([](auto&& attribute) { return attribute.index(); }, layout[i]),
+        };
+    }
+
+    auto error = std::error_code{};
+    std::filesystem::create_directories(cache_folder(), error);
+    if (error)
+        return;
+
+    // Write to a temporary file first, so that another instance of the app never reads a half-written mesh
+    auto const path           = cache_file(key);
+    auto const temporary_path = std::filesystem::path{path}.replace_extension(".tmp");
+    {
+        auto       file    = std::ofstream{temporary_path, std::ios::binary | std::ios::trunc};
+        auto const padding = std::array<char, blob_alignment>{};
+        auto const pad_to  = [&](uint64_t offset) {
+            file.write(padding.data(), static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+        };
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header)); // NOLINT(*reinterpret-cast)
+        pad_to(header.vertices_offset);
+        file.write(reinterpret_cast<char const*>(vertices.data()), static_cast<std::streamsize>(vertices.size())); // NOLINT(*reinterpret-cast)
+        pad_to(header.indices_offset);
+        file.write(reinterpret_cast<char const*>(index_bytes.data()), static_cast<std::streamsize>(index_bytes.size())); // NOLINT(*reinterpret-cast)
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
+}
+
+} // namespace gl::internal
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+
+namespace gl::internal {
+
+/// A mesh read from the cache. `vertices` and `indices` point directly into the memory-mapped file, so they can be uploaded without any parsing nor copying.
+struct CachedMesh {
+    MappedFile                      file;
+    std::vector<AnyVertexAttribute> layout{};
+    std::span<std::byte const>      vertices{};
+    std::span<std::byte const>      indices{}; // Stored as `index_type`, which is the smallest type that fits them (see Mesh_Descriptor::index_buffer_bytes)
+    IndexType                       index_type{IndexType::UInt32};
+};
+
+/// Converts the indices of `mesh` back to uint32_t, for when you need to work on them on the CPU.
+auto indices_as_uint32(CachedMesh const& mesh) -> std::vector<uint32_t>;
+
+/// Identifies a version of a source file (.obj, etc.) by its path, size and last write time, so that editing the file invalidates the cache.
+auto mesh_cache_key(std::filesystem::path const& source_file) -> uint64_t;
+
+/// Returns nullopt if the mesh is not in the cache (or if the cached file is invalid), in which case you must load the source file and call save_cached_mesh().
+auto load_cached_mesh(uint64_t key) -> std::optional<CachedMesh>;
+/// The cache is only an optimization, so failing to write it is silently ignored.
+/// `vertices` are laid out as described by `layout`. The indices are stored with the smallest type that fits them, so that loading the mesh doesn't need to convert them.
+void save_cached_mesh(uint64_t key, std::span<AnyVertexAttribute const> layout, std::span<std::byte const> vertices, std::span<uint32_t const> indices);
+
+} // namespace gl::internal
@@ -0,0 +1,37 @@
+#include "MeshData.hpp"
+#include <numeric>
+
+namespace gl {
+
+auto MeshData::floats_per_vertex() const -> size_t
+{
+    return std::accumulate(layout.begin(), layout.end(), size_t{0}, [](size_t acc, AnyVertexAttribute const& attribute) {
+        return acc + static_cast<size_t>(std::visit([](auto&& attribute) { return attribute.size_in_bytes(); }, attribute)) / sizeof(float);
+    });
+}
+
+auto MeshData::vertices_count() const -> size_t
+{
+    auto const floats_count = floats_per_vertex();
+    return floats_count == 0 ? 0 : vertices.size() / floats_count;
+}
+
+auto MeshData::position_offset() const -> std::optional<size_t>
+{
+    size_t offset = 0;
+    for (auto const& attribute : layout)
+    {
+        if (std::holds_alternative<VertexAttribute::Vec3>(attribute) && std::get<VertexAttribute::Vec3>(attribute).index() == 0)
+            return offset;
+        offset += static_cast<size_t>(std::visit([](auto&& attribute) { return attribute.size_in_bytes(); }, attribute)) / sizeof(float);
+    }
+    return std::nullopt;
+}
+
+auto make_mesh(MeshData const& data) -> Mesh
+{
+    auto const vertex_buffers = std::vector{VertexBuffer_Descriptor{.layout = data.layout, .data = data.vertices}};
+    return Mesh{Mesh_Descriptor{.vertex_buffers = vertex_buffers, .index_buffer = data.indices}};
+}
+
+} // namespace gl
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "Mesh.hpp"
+
+namespace gl {
+
+/// Geometry on the CPU side, as expected by gl::Mesh: a single interleaved vertex buffer, and an index buffer.
+/// This is what the mesh importers produce, and what the optimization passes (see optimize_mesh()) work on.
+/// All the attributes are 32-bit floats. See quantize_mesh() to convert them to more compact formats before uploading them to the GPU.
+struct MeshData {
+    std::vector<AnyVertexAttribute> layout{};
+    std::vector<float>              vertices{}; // Interleaved, as described by `layout`
+    std::vector<uint32_t>           indices{};
+
+    auto floats_per_vertex() const -> size_t;
+    auto vertices_count() const -> size_t;
+    /// Offset (in floats) of the 3D position at location 0 in each vertex, if the layout has one.
+    auto position_offset() const -> std::optional<size_t>;
+};
+
+/// Uploads `data` to the GPU.
+auto make_mesh(MeshData const& data) -> Mesh;
+
+} // namespace gl
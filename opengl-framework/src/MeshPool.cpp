@@ -0,0 +1,310 @@
+#include "MeshPool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include "Shader.hpp"
+#include "StateCache.hpp"
+
+namespace gl {
+
+namespace internal {
+
+RangeAllocator::RangeAllocator(size_t capacity)
+    : _capacity{capacity}
+{
+    if (capacity != 0)
+        _free_ranges.emplace(0, capacity);
+}
+
+auto RangeAllocator::allocate(size_t size) -> std::optional<size_t>
+{
+    if (size == 0)
+        return 0;
+    auto const range = std::find_if(_free_ranges.begin(), _free_ranges.end(), [&](auto const& range) { return range.second >= size; });
+    if (range == _free_ranges.end())
+        return std::nullopt;
+
+    auto const [offset, range_size] = *range;
+    _free_ranges.erase(range);
+    if (range_size > size)
+        _free_ranges.emplace(offset + size, range_size - size);
+    return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+    auto range = _free_ranges.emplace(offset, size).first;
+
+    // Merge with the next range
+    auto const next = std::next(range);
+    if (next != _free_ranges.end() && range->first + range->second == next->first)
+    {
+        range->second += next->second;
+        _free_ranges.erase(next);
+    }
+    // Merge with the previous range
+    if (range != _free_ranges.begin())
+    {
+        auto const previous = std::prev(range);
+        if (previous->first + previous->second == range->first)
+        {
+            previous->second += range->second;
+            _free_ranges.erase(range);
+        }
+    }
+}
+
+void RangeAllocator::grow(size_t new_capacity)
+{
+    assert(new_capacity >= _capacity);
+    auto const old_capacity = _capacity;
+    _capacity               = new_capacity;
+    free(old_capacity, new_capacity - old_capacity);
+}
+
+} // namespace internal
+
+static auto index_size_in_bytes(IndexType index_type) -> size_t
+{
+    assert((index_type == IndexType::UInt16 || index_type == IndexType::UInt32) && "A MeshPool only supports 16-bit and 32-bit indices.");
+    return index_type == IndexType::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+/// Creates a new buffer of `new_size_in_bytes`, that starts with the content of `buffer`, and replaces `buffer` with it.
+static void grow_buffer(internal::UniqueBuffer& buffer, size_t old_size_in_bytes, size_t new_size_in_bytes)
+{
+    auto new_buffer = internal::UniqueBuffer{};
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer.id());
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(new_size_in_bytes), nullptr, GL_STATIC_DRAW);
+    if (old_size_in_bytes != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.id());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(old_size_in_bytes));
+    }
+    buffer = std::move(new_buffer);
+}
+
+MeshPool::MeshPool(MeshPool_Descriptor const& desc)
+    : _layout{desc.layout}
+    , _stride{internal::vertex_stride(desc.layout)}
+    , _index_type{desc.index_type == IndexType::UInt16 ? static_cast<GLenum>(GL_UNSIGNED_SHORT) : static_cast<GLenum>(GL_UNSIGNED_INT)}
+    , _index_size_in_bytes{index_size_in_bytes(desc.index_type)}
+    , _instance_index_location{desc.instance_index_location}
+    , _vertices_allocator{0}
+    , _indices_allocator{0}
+{
+    glGenVertexArrays(1, &_vertex_array);
+    grow_buffer(_vertex_buffer, 0, desc.initial_vertices_capacity * static_cast<size_t>(_stride));
+    grow_buffer(_index_buffer, 0, desc.initial_indices_capacity * _index_size_in_bytes);
+    _vertices_allocator.grow(desc.initial_vertices_capacity);
+    _indices_allocator.grow(desc.initial_indices_capacity);
+    bind_buffers_to_vertex_array();
+}
+
+MeshPool::~MeshPool()
+{
+    state_cache().forget_vertex_array(_vertex_array);
+    glDeleteVertexArrays(1, &_vertex_array);
+}
+
+void MeshPool::bind_buffers_to_vertex_array()
+{
+    state_cache().bind_vertex_array(_vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffer.id());
+    internal::set_vertex_attribute_pointers(_layout, 0, 0);
+    if (_instance_index_location >= 0)
+    {
+        glEnableVertexAttribArray(static_cast<GLuint>(_instance_index_location));
+        glVertexAttribDivisor(static_cast<GLuint>(_instance_index_location), 1);
+        point_instance_index_to(0);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _index_buffer.id()); // Part of the state of the vertex array
+}
+
+void MeshPool::point_instance_index_to(uint32_t base_instance)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, _instance_index_buffer.id());
+    glVertexAttribIPointer(static_cast<GLuint>(_instance_index_location), 1, GL_UNSIGNED_INT, 0, reinterpret_cast<void const*>(base_instance * sizeof(uint32_t))); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+}
+
+auto MeshPool::allocate_vertices(size_t count) -> size_t
+{
+    if (auto const offset = _vertices_allocator.allocate(count))
+        return *offset;
+
+    auto const old_capacity = _vertices_allocator.capacity();
+    auto const new_capacity = std::max(2 * old_capacity, old_capacity + count);
+    grow_buffer(_vertex_buffer, old_capacity * static_cast<size_t>(_stride), new_capacity * static_cast<size_t>(_stride));
+    _vertices_allocator.grow(new_capacity);
+    bind_buffers_to_vertex_array();
+    return *_vertices_allocator.allocate(count); // There is enough room at the end now
+}
+
+auto MeshPool::allocate_indices(size_t count) -> size_t
+{
+    if (auto const offset = _indices_allocator.allocate(count))
+        return *offset;
+
+    auto const old_capacity = _indices_allocator.capacity();
+    auto const new_capacity = std::max(2 * old_capacity, old_capacity + count);
+    grow_buffer(_index_buffer, old_capacity * _index_size_in_bytes, new_capacity * _index_size_in_bytes);
+    _indices_allocator.grow(new_capacity);
+    bind_buffers_to_vertex_array();
+    return *_indices_allocator.allocate(count);
+}
+
+void MeshPool::upload_vertices(std::span<std::byte const> vertices, size_t first_vertex)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _vertex_buffer.id());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(first_vertex * static_cast<size_t>(_stride)), static_cast<GLsizeiptr>(vertices.size()), vertices.data());
+}
+
+void MeshPool::upload_indices(std::span<uint32_t const> indices, size_t first_index)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _index_buffer.id());
+    auto const offset = static_cast<GLintptr>(first_index * _index_size_in_bytes);
+    if (_index_type == GL_UNSIGNED_INT)
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, static_cast<GLsizeiptr>(indices.size_bytes()), indices.data());
+    }
+    else
+    {
+        auto narrow_indices = std::vector<uint16_t>(indices.size());
+        std::transform(indices.begin(), indices.end(), narrow_indices.begin(), [](uint32_t index) { return static_cast<uint16_t>(index); });
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, static_cast<GLsizeiptr>(narrow_indices.size() * sizeof(uint16_t)), narrow_indices.data());
+    }
+}
+
+auto MeshPool::add(std::span<std::byte const> vertices, std::span<uint32_t const> indices) -> MeshPoolHandle
+{
+    assert(vertices.size() % static_cast<size_t>(_stride) == 0 && "The vertices don't match the layout of the pool.");
+    assert(indices.size() % 3 == 0 && "You must provide 3 indices for each triangle");
+    auto const vertices_count = vertices.size() / static_cast<size_t>(_stride);
+    assert((_index_type == GL_UNSIGNED_INT || vertices_count <= 0x10000) && "This mesh has too many vertices for a pool with 16-bit indices.");
+    assert(std::all_of(indices.begin(), indices.end(), [&](uint32_t index) { return index < vertices_count; }) && "Some indices are bigger than the number of vertices.");
+
+    auto const range = MeshRange{
+        .first_vertex   = allocate_vertices(vertices_count),
+        .vertices_count = vertices_count,
+        .first_index    = allocate_indices(indices.size()),
+        .indices_count  = indices.size(),
+        .is_alive       = true,
+    };
+    upload_vertices(vertices, range.first_vertex);
+    upload_indices(indices, range.first_index);
+
+    if (!_free_handles.empty())
+    {
+        auto const handle = _free_handles.back();
+        _free_handles.pop_back();
+        _meshes[handle] = range;
+        return {handle};
+    }
+    _meshes.push_back(range);
+    return {static_cast<uint32_t>(_meshes.size() - 1)};
+}
+
+auto MeshPool::add(MeshData const& mesh) -> MeshPoolHandle
+{
+    return add(std::as_bytes(std::span{mesh.vertices}), mesh.indices);
+}
+
+auto MeshPool::add(QuantizedMeshData const& mesh) -> MeshPoolHandle
+{
+    return add(mesh.vertices, mesh.indices);
+}
+
+void MeshPool::remove(MeshPoolHandle mesh)
+{
+    assert(mesh.index < _meshes.size() && _meshes[mesh.index].is_alive && "This mesh is not in the pool.");
+    auto& range = _meshes[mesh.index];
+    _vertices_allocator.free(range.first_vertex, range.vertices_count);
+    _indices_allocator.free(range.first_index, range.indices_count);
+    range.is_alive = false;
+    _free_handles.push_back(mesh.index);
+}
+
+auto MeshPool::command(MeshPoolHandle mesh, uint32_t instances_count, uint32_t base_instance) const -> DrawElementsIndirectCommand
+{
+    assert(mesh.index < _meshes.size() && _meshes[mesh.index].is_alive && "This mesh is not in the pool.");
+    auto const& range = _meshes[mesh.index];
+    return {
+        .count          = static_cast<GLuint>(range.indices_count),
+        .instance_count = instances_count,
+        .first_index    = static_cast<GLuint>(range.first_index),
+        .base_vertex    = static_cast<GLint>(range.first_vertex),
+        .base_instance  = base_instance,
+    };
+}
+
+void MeshPool::push_draw(MeshPoolHandle mesh, uint32_t instances_count)
+{
+    _queued_commands.push_back(command(mesh, instances_count, _queued_instances_count));
+    _queued_instances_count += instances_count;
+}
+
+void MeshPool::reserve_instances(size_t instances_count)
+{
+    if (_instance_index_location < 0 || instances_count <= _instances_capacity)
+        return;
+
+    _instances_capacity = std::max(instances_count, 2 * _instances_capacity);
+    auto indices        = std::vector<uint32_t>(_instances_capacity);
+    std::iota(indices.begin(), indices.end(), 0u);
+    _instance_index_buffer = internal::UniqueBuffer{};
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _instance_index_buffer.id());
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), indices.data(), GL_STATIC_DRAW);
+    bind_buffers_to_vertex_array();
+}
+
+void MeshPool::draw_queued()
+{
+    if (_queued_commands.empty())
+        return;
+
+    reserve_instances(_queued_instances_count);
+    if (!multi_draw_indirect_is_supported())
+    {
+        draw_queued_one_by_one();
+        return;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _command_buffer.id());
+    // Re-specifying the whole storage lets the driver orphan the previous one instead of waiting for the GPU to be done with it
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(_queued_commands.size() * sizeof(DrawElementsIndirectCommand)), _queued_commands.data(), GL_STREAM_DRAW);
+    state_cache().bind_vertex_array(_vertex_array);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, _index_type, nullptr, static_cast<GLsizei>(_queued_commands.size()), 0);
+
+    _queued_commands.clear(); // Keeps the capacity, so that next frame doesn't need to allocate
+    _queued_instances_count = 0;
+}
+
+void MeshPool::draw_queued_one_by_one()
+{
+    state_cache().bind_vertex_array(_vertex_array);
+    for (auto const& command : _queued_commands)
+    {
+        if (_instance_index_location >= 0) // glDrawElementsInstancedBaseVertex() has no base instance, so we offset the buffer instead
+            point_instance_index_to(command.base_instance);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), _index_type, reinterpret_cast<void const*>(command.first_index * _index_size_in_bytes), static_cast<GLsizei>(command.instance_count), command.base_vertex); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+    }
+    if (_instance_index_location >= 0)
+        point_instance_index_to(0);
+
+    _queued_commands.clear();
+    _queued_instances_count = 0;
+}
+
+void MeshPool::draw_indirect(Buffer const& commands, size_t commands_count, size_t offset_in_bytes)
+{
+    assert(multi_draw_indirect_is_supported() && "draw_indirect() requires OpenGL 4.3, which is not available on this machine. Use push_draw() and draw_queued() instead.");
+    assert(offset_in_bytes + commands_count * sizeof(DrawElementsIndirectCommand) <= commands.size_in_bytes() && "There are not that many commands in the buffer.");
+    if (commands_count == 0)
+        return;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.id());
+    state_cache().bind_vertex_array(_vertex_array);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, _index_type, reinterpret_cast<void const*>(offset_in_bytes), static_cast<GLsizei>(commands_count), 0); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+}
+
+} // namespace gl
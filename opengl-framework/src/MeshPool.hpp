@@ -0,0 +1,136 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+#include "Buffer.hpp"
+#include "Mesh.hpp"
+#include "MeshData.hpp"
+#include "quantize_mesh.hpp"
+
+namespace gl {
+
+/// The layout of the commands read by glMultiDrawElementsIndirect(). You only need it if you fill the commands yourself, e.g. in a compute shader that does culling (see MeshPool::draw_indirect()).
+struct DrawElementsIndirectCommand {
+    GLuint count{};          // Number of indices
+    GLuint instance_count{}; // Number of instances
+    GLuint first_index{};    // Offset of the first index, in indices (not in bytes)
+    GLint  base_vertex{};    // Added to each index
+    GLuint base_instance{};  // Offset of the first instance, in the vertex buffers that have a divisor
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(GLuint), "Must match the layout that OpenGL expects");
+
+/// Identifies a mesh inside a MeshPool.
+struct MeshPoolHandle {
+    uint32_t index{};
+};
+
+struct MeshPool_Descriptor {
+    std::vector<AnyVertexAttribute> const& layout; // NOLINT(*avoid-const-or-ref-data-members) Shared by all the meshes of the pool
+    /// The indices are relative to the first vertex of each mesh, so IndexType::UInt16 works as long as each mesh has at most 65536 vertices, no matter how many vertices the whole pool contains.
+    /// IndexType::Automatic is not allowed, because we don't know in advance which meshes will be added.
+    IndexType index_type{IndexType::UInt32};
+    /// If not -1, each instance receives at this location its index in the whole multi-draw (declared as `in uint` in the shader). Use it to read per-object data (transform, color, etc.) from a storage buffer.
+    /// (gl_DrawID and gl_BaseInstance would do the job, but they require OpenGL 4.6)
+    int instance_index_location{-1};
+    /// The buffers grow automatically when they are full, but growing copies the whole buffer, so it is better to have a good guess.
+    size_t initial_vertices_capacity{64 * 1024};
+    size_t initial_indices_capacity{3 * 64 * 1024};
+};
+
+namespace internal {
+/// Finds free ranges in a block of memory (first fit), and merges the ranges that are freed next to each other.
+/// It only does the bookkeeping: offsets and sizes are in whatever unit you want (vertices, indices, etc.).
+class RangeAllocator {
+public:
+    explicit RangeAllocator(size_t capacity);
+
+    /// Returns nullopt if there is no free range big enough, in which case you can grow() and try again.
+    auto allocate(size_t size) -> std::optional<size_t>;
+    void free(size_t offset, size_t size);
+    /// Adds free space at the end.
+    void grow(size_t new_capacity);
+
+    auto capacity() const -> size_t { return _capacity; }
+
+private:
+    size_t                   _capacity{};
+    std::map<size_t, size_t> _free_ranges{}; // Offset -> size
+};
+} // namespace internal
+
+/// Stores many meshes that share the same layout in one big vertex buffer and one big index buffer, so that they can all be drawn with a single draw call.
+/// Drawing 1000 small gl::Mesh costs 1000 vertex array binds and 1000 draw calls, which quickly becomes the bottleneck of the frame. With a MeshPool it is one of each, thanks to glMultiDrawElementsIndirect().
+/// glMultiDrawElementsIndirect() requires OpenGL 4.3 (see multi_draw_indirect_is_supported()). Without it, draw_queued() still binds the vertex array only once, but issues one draw call per mesh, and draw_indirect() is not available.
+class MeshPool {
+public:
+    explicit MeshPool(MeshPool_Descriptor const&);
+    MeshPool(MeshPool const&)                    = delete;
+    auto operator=(MeshPool const&) -> MeshPool& = delete;
+    MeshPool(MeshPool&&)                         = delete;
+    auto operator=(MeshPool&&) -> MeshPool&      = delete;
+    ~MeshPool();
+
+    /// `vertices` must be laid out as described by the layout of the pool. The indices are relative to the first vertex of this mesh, like for a gl::Mesh.
+    auto add(std::span<std::byte const> vertices, std::span<uint32_t const> indices) -> MeshPoolHandle;
+    auto add(MeshData const& mesh) -> MeshPoolHandle;
+    auto add(QuantizedMeshData const& mesh) -> MeshPoolHandle;
+    /// The space of the mesh is reused by the meshes that you will add next, so don't draw it anymore.
+    void remove(MeshPoolHandle mesh);
+
+    /// Queues a draw of `mesh`. Nothing is drawn until you call draw_queued().
+    void push_draw(MeshPoolHandle mesh, uint32_t instances_count = 1);
+    /// Draws all the meshes queued with push_draw() in a single draw call, and empties the queue.
+    void draw_queued();
+
+    /// The command that draws `mesh`, if you want to fill your own buffer of commands (see draw_indirect()).
+    auto command(MeshPoolHandle mesh, uint32_t instances_count = 1, uint32_t base_instance = 0) const -> DrawElementsIndirectCommand;
+    /// Draws `commands_count` DrawElementsIndirectCommand read from `commands`, typically written by a compute shader. This way the CPU doesn't even need to know what is drawn. Requires OpenGL 4.3.
+    /// If you use MeshPool_Descriptor::instance_index_location, call reserve_instances() first with the biggest base_instance + instance_count of all the commands.
+    void draw_indirect(Buffer const& commands, size_t commands_count, size_t offset_in_bytes = 0);
+    void reserve_instances(size_t instances_count);
+
+private:
+    struct MeshRange {
+        size_t first_vertex{};
+        size_t vertices_count{};
+        size_t first_index{};
+        size_t indices_count{};
+        bool   is_alive{false};
+    };
+
+    void upload_vertices(std::span<std::byte const> vertices, size_t first_vertex);
+    void upload_indices(std::span<uint32_t const> indices, size_t first_index);
+    auto allocate_vertices(size_t count) -> size_t;
+    auto allocate_indices(size_t count) -> size_t;
+    void bind_buffers_to_vertex_array();
+    /// Makes the first instance read its index at `base_instance` in _instance_index_buffer.
+    void point_instance_index_to(uint32_t base_instance);
+    void draw_queued_one_by_one();
+
+private:
+    std::vector<AnyVertexAttribute> _layout;
+    GLsizei                         _stride;
+    GLenum                          _index_type;
+    size_t                          _index_size_in_bytes;
+    int                             _instance_index_location;
+
+    GLuint                 _vertex_array{};
+    internal::UniqueBuffer _vertex_buffer{};
+    internal::UniqueBuffer _index_buffer{};
+    internal::UniqueBuffer _instance_index_buffer{}; // Contains 0, 1, 2, 3, ... so that each instance reads its own index, offset by the base_instance of its draw
+    internal::UniqueBuffer _command_buffer{};
+
+    internal::RangeAllocator _vertices_allocator;
+    internal::RangeAllocator _indices_allocator;
+    size_t                   _instances_capacity{0};
+
+    std::vector<MeshRange>                   _meshes{};
+    std::vector<uint32_t>                    _free_handles{}; // Indices in _meshes that can be reused
+    std::vector<DrawElementsIndirectCommand> _queued_commands{};
+    uint32_t                                 _queued_instances_count{0};
+};
+
+} // namespace gl
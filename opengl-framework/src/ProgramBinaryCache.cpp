@@ -0,0 +1,120 @@
+#include "ProgramBinaryCache.hpp"
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string_view>
+#include <vector>
+#include "Hasher.hpp"
+#include "exe_path/exe_path.h"
+
+namespace gl::internal {
+
+namespace {
+
+constexpr uint32_t file_magic_number = 0x42505247; // "GRPB", followed by the binary format and the binary itself
+
+auto gl_string(GLenum name) -> std::string_view
+{
+    auto const* str = glGetString(name);
+    return str != nullptr ? reinterpret_cast<char const*>(str) : ""; // NOLINT(*reinterpret-cast)
+}
+
+auto program_binaries_are_supported() -> bool
+{
+    static bool const supported = []() {
+        GLint formats_count{};
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_count);
+        return formats_count > 0;
+    }();
+    return supported;
+}
+
+auto cache_folder() -> std::filesystem::path
+{
+    return exe_path::user_data() / "opengl-framework" / "program-binaries" / exe_path::exe().stem();
+}
+
+auto cache_file(uint64_t key) -> std::filesystem::path
+{
+    return cache_folder() / std::format("{:016x}.bin", key);
+}
+
+} // namespace
+
+auto program_binary_cache_key(std::span<ShaderStageSource const> stages) -> uint64_t
+{
+    auto hasher = Hasher{};
+    hasher.add(gl_string(GL_VENDOR));
+    hasher.add(gl_string(GL_RENDERER));
+    hasher.add(gl_string(GL_VERSION));
+    for (auto const& stage : stages)
+    {
+        hasher.add(static_cast<uint64_t>(stage.kind));
+        hasher.add(stage.code);
+    }
+    return hasher.hash();
+}
+
+auto load_program_binary(GLuint program, uint64_t key) -> bool
+{
+    if (!program_binaries_are_supported())
+        return false;
+
+    auto file = std::ifstream{cache_file(key), std::ios::binary};
+    if (!file)
+        return false;
+
+    uint32_t magic_number{};
+    GLenum   binary_format{};
+    file.read(reinterpret_cast<char*>(&magic_number), sizeof(magic_number));   // NOLINT(*reinterpret-cast)
+    file.read(reinterpret_cast<char*>(&binary_format), sizeof(binary_format)); // NOLINT(*reinterpret-cast)
+    if (!file || magic_number != file_magic_number)
+        return false;
+    auto const binary = std::vector<char>{std::istreambuf_iterator<char>{file}, {}};
+    if (binary.empty())
+        return false;
+
+    glProgramBinary(program, binary_format, binary.data(), static_cast<GLsizei>(binary.size()));
+    // This fails if the driver doesn't accept this binary anymore (e.g. it has been updated). We will then compile the program and overwrite the binary.
+    GLint link_status{};
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+    return link_status == GL_TRUE;
+}
+
+void save_program_binary(GLuint program, uint64_t key)
+{
+    if (!program_binaries_are_supported())
+        return;
+
+    GLint binary_length{};
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (binary_length <= 0)
+        return;
+    auto   binary = std::vector<char>(static_cast<size_t>(binary_length));
+    GLenum binary_format{};
+    glGetProgramBinary(program, binary_length, nullptr, &binary_format, binary.data());
+
+    auto error = std::error_code{};
+    std::filesystem::create_directories(cache_folder(), error);
+    if (error)
+        return;
+
+    // Write to a temporary file first, so that another instance of the app never reads a half-written binary
+    auto const path           = cache_file(key);
+    auto const temporary_path = std::filesystem::path{path}.replace_extension(".tmp");
+    {
+        auto file = std::ofstream{temporary_path, std::ios::binary | std::ios::trunc};
+        file.write(reinterpret_cast<char const*>(&file_magic_number), sizeof(file_magic_number)); // NOLINT(*reinterpret-cast)
+        file.write(reinterpret_cast<char const*>(&binary_format), sizeof(binary_format));         // NOLINT(*reinterpret-cast)
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(temporary_path, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
+}
+
+} // namespace gl::internal
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include "glad/gl.h"
+
+namespace gl::internal {
+
+struct ShaderStageSource {
+    GLenum      kind{}; // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, etc.
+    std::string code{};
+};
+
+/// Identifies a program by the code of all its stages (including any #define they contain) and by the driver that compiles it, since program binaries are only valid for the exact same driver.
+auto program_binary_cache_key(std::span<ShaderStageSource const> stages) -> uint64_t;
+
+/// Returns true iff the program has been loaded from the cache and is linked. Otherwise (not cached yet, driver updated, etc.) the program is left untouched and must be compiled and linked normally.
+auto load_program_binary(GLuint program, uint64_t key) -> bool;
+/// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+/// The cache is only an optimization, so failing to write it is silently ignored.
+void save_program_binary(GLuint program, uint64_t key);
+
+} // namespace gl::internal
@@ -1,5 +1,4 @@
 #include "RenderTarget.hpp"
-#include <array>
 #include "Texture.hpp"
 #include "handle_error.hpp"
 
@@ -97,25 +96,23 @@ RenderTarget::RenderTarget(RenderTarget_Descriptor const& desc)
 
 void RenderTarget::render(std::function<void()> const& render_fn)
 {
-    // Store previous state to restore it at the end
-    int                previous_draw_framebuffer{};
-    int                previous_read_framebuffer{};
-    std::array<int, 4> previous_viewport{};
-    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_draw_framebuffer);
-    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
-    glGetIntegerv(GL_VIEWPORT, previous_viewport.data());
+    // Store previous state to restore it at the end. The state cache knows it already, so this doesn't need to query OpenGL.
+    auto&            cache                     = state_cache();
+    GLuint const     previous_draw_framebuffer = cache.draw_framebuffer();
+    GLuint const     previous_read_framebuffer = cache.read_framebuffer();
+    glm::ivec4 const previous_viewport         = cache.viewport();
 
     // Bind our framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, _id.id());
-    glViewport(0, 0, _desc.width, _desc.height);
+    cache.bind_framebuffer(GL_FRAMEBUFFER, _id.id());
+    cache.set_viewport({0, 0, _desc.width, _desc.height});
 
     // Render
     render_fn();
 
     // Re-bind previous framebuffer
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous_draw_framebuffer);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_framebuffer);
-    glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+    cache.bind_framebuffer(GL_DRAW_FRAMEBUFFER, previous_draw_framebuffer);
+    cache.bind_framebuffer(GL_READ_FRAMEBUFFER, previous_read_framebuffer);
+    cache.set_viewport(previous_viewport);
 }
 
 void RenderTarget::resize(int width, int height)
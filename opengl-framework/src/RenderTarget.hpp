@@ -1,5 +1,6 @@
 #pragma once
 #include <functional>
+#include "StateCache.hpp"
 #include "Texture.hpp"
 #include "glad/gl.h"
 
@@ -14,6 +15,7 @@ public:
     }
     ~UniqueFramebuffer()
     {
+        state_cache().forget_framebuffer(_id);
         glDeleteFramebuffers(1, &_id);
     }
     UniqueFramebuffer(UniqueFramebuffer const&)                    = delete; // You cannot copy
@@ -27,6 +29,7 @@ public:
     {
         if (&o != this)
         {
+            state_cache().forget_framebuffer(_id);
             glDeleteFramebuffers(1, &_id);
             _id   = o._id;
             o._id = 0;
@@ -1,6 +1,15 @@
 #include "Shader.hpp"
+#include <algorithm>
 #include <cassert>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include "FileWatcher.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "ShaderPreprocessor.hpp"
+#include "StateCache.hpp"
+#include "extensions.hpp"
 #include "Texture.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "handle_error.hpp"
@@ -8,25 +17,47 @@
 
 namespace {
 
-void compile_shader_module(GLuint id, std::string const& source_code)
+struct HotReloadSettings {
+    bool                  is_enabled{false};
+    std::filesystem::path resources_folder{};
+};
+
+auto hot_reload_settings() -> HotReloadSettings&
+{
+    static auto instance = HotReloadSettings{};
+    return instance;
+}
+
+auto resolve_shader_file(std::filesystem::path const& path) -> std::filesystem::path
+{
+    // res/ is copied next to the executable at build time, so when hot reloading we want to read the original files instead, because those are the ones that get edited
+    auto const& settings = hot_reload_settings();
+    if (settings.is_enabled && !settings.resources_folder.empty() && path.is_relative() && std::filesystem::exists(settings.resources_folder / path))
+        return settings.resources_folder / path;
+    return gl::make_absolute_path(path);
+}
+
+void start_compiling_shader_module(GLuint id, std::string const& source_code)
 {
     char const* src = source_code.c_str();
     glShaderSource(id, 1, &src, nullptr);
     glCompileShader(id);
+}
 
-    { // Check for errors
-        int result;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-        if (result)
-            return; // Compilation successful
+/// Blocks until the compilation is done.
+void check_for_compilation_errors(GLuint id, std::string const& source_code)
+{
+    int result;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+    if (result)
+        return; // Compilation successful
 
-        GLsizei length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-        std::vector<GLchar> error_message;
-        error_message.resize(static_cast<size_t>(length));
-        glGetShaderInfoLog(id, length, nullptr, error_message.data());
-        gl::handle_error(std::format("Shader Compilation failed:\n{}\n\nThe code we tried to compile was:\n{}", error_message.data(), source_code));
-    }
+    GLsizei length;
+    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+    std::vector<GLchar> error_message;
+    error_message.resize(static_cast<size_t>(length));
+    glGetShaderInfoLog(id, length, nullptr, error_message.data());
+    gl::handle_error(std::format("Shader Compilation failed:\n{}\n\nThe code we tried to compile was:\n{}", error_message.data(), source_code));
 }
 
 auto get_source_code(gl::ShaderSource::Code const& source) -> std::string
@@ -35,16 +66,16 @@ auto get_source_code(gl::ShaderSource::Code const& source) -> std::string
 }
 auto get_source_code(gl::ShaderSource::File const& source) -> std::string
 {
-    auto ifs = std::ifstream{gl::make_absolute_path(source.path)};
+    auto ifs = std::ifstream{resolve_shader_file(source.path)};
     return std::string{std::istreambuf_iterator<char>{ifs}, {}};
 }
 
 class UniqueShaderModule {
 public:
-    explicit UniqueShaderModule(GLenum shader_kind, gl::AnyShaderSource const& source)
-        : _id{glCreateShader(shader_kind)}
+    explicit UniqueShaderModule(gl::internal::ShaderStageSource const& source)
+        : _id{glCreateShader(source.kind)}
     {
-        compile_shader_module(_id, std::visit([](auto&& source) { return get_source_code(source); }, source));
+        start_compiling_shader_module(_id, source.code); // Errors are checked later, so that the driver can compile several modules in parallel
     }
     ~UniqueShaderModule()
     {
@@ -74,6 +105,7 @@ private:
     GLuint _id;
 };
 
+/// Blocks until the linking is done.
 void check_for_linking_errors(GLuint shader_id)
 {
     int result;
@@ -89,20 +121,348 @@ void check_for_linking_errors(GLuint shader_id)
     }
 }
 
+struct ShaderSources {
+    std::vector<gl::internal::ShaderStageSource> stages{}; // Preprocessed, ready to be compiled
+    std::vector<std::filesystem::path>           files{};  // All the files the code comes from, including the #included ones
+};
+
+auto read_sources(std::span<gl::internal::ShaderStageDescription const> stages, std::span<gl::ShaderDefine const> defines) -> ShaderSources
+{
+    auto res = ShaderSources{};
+    res.stages.reserve(stages.size());
+    auto const add_file = [&](std::filesystem::path const& file) {
+        if (std::find(res.files.begin(), res.files.end(), file) == res.files.end())
+            res.files.push_back(file);
+    };
+    for (auto const& stage : stages)
+    {
+        if (auto const* file = std::get_if<gl::ShaderSource::File>(&stage.source))
+            add_file(resolve_shader_file(file->path).lexically_normal());
+        auto preprocessed = gl::internal::preprocess_shader(
+            std::visit([](auto&& source) { return get_source_code(source); }, stage.source),
+            defines,
+            &resolve_shader_file
+        );
+        for (auto const& file : preprocessed.included_files)
+            add_file(file);
+        res.stages.push_back({.kind = stage.kind, .code = std::move(preprocessed.code)});
+    }
+    return res;
+}
+
 } // namespace
 
 namespace gl {
 
-Shader::Shader(Shader_Descriptor const& desc)
+namespace internal {
+/// Everything we need to keep until the driver is done compiling and linking a program.
+struct PendingProgram {
+    std::vector<ShaderStageSource>  stages{};
+    std::vector<UniqueShaderModule> modules{};
+    uint64_t                        cache_key{};
+};
+
+/// Only exists for shaders that have been created from files while hot reload was enabled.
+struct HotReloadState {
+    std::vector<ShaderStageDescription>         stages{};
+    std::vector<ShaderDefine>                   defines{};
+    std::vector<std::filesystem::path>          files{};
+    std::vector<std::pair<std::string, GLuint>> uniform_block_bindings{}; // Must be applied again to the new program
+    std::optional<UniqueShader>                 next_program{};
+    std::unique_ptr<PendingProgram>             next_pending_program{}; // nullptr if next_program has been loaded from the cache
+};
+
+static auto file_watcher() -> std::optional<FileWatcher>&
+{
+    static auto instance = std::optional<FileWatcher>{};
+    return instance;
+}
+
+static auto hot_reloadable_shaders() -> std::vector<Shader*>&
+{
+    static auto instance = std::vector<Shader*>{};
+    return instance;
+}
+
+static void replace_hot_reloadable_shader(Shader* old_shader, Shader* new_shader)
+{
+    auto& shaders = hot_reloadable_shaders();
+    auto  it      = std::find(shaders.begin(), shaders.end(), old_shader);
+    if (it == shaders.end())
+        return;
+    if (new_shader != nullptr)
+        *it = new_shader;
+    else
+        shaders.erase(it);
+}
+
+static auto make_hot_reload_state(std::vector<ShaderStageDescription> stages, std::vector<ShaderDefine> defines, std::vector<std::filesystem::path> files) -> std::unique_ptr<HotReloadState>
+{
+    if (!hot_reload_settings().is_enabled || files.empty())
+        return nullptr;
+    for (auto const& file : files)
+        file_watcher()->watch(file);
+    return std::make_unique<HotReloadState>(HotReloadState{.stages = std::move(stages), .defines = std::move(defines), .files = std::move(files)});
+}
+
+void reload_changed_shaders()
+{
+    if (!file_watcher().has_value())
+        return;
+    auto const changed_files = file_watcher()->take_changed_files();
+    for (Shader* shader : hot_reloadable_shaders())
+    {
+        auto const& files = shader->_hot_reload->files;
+        if (std::any_of(changed_files.begin(), changed_files.end(), [&](auto const& changed_file) { return std::find(files.begin(), files.end(), changed_file) != files.end(); }))
+            shader->start_reload();
+        shader->try_finish_reload();
+    }
+}
+} // namespace internal
+
+void enable_shaders_hot_reload(std::filesystem::path const& resources_folder)
+{
+    hot_reload_settings() = {.is_enabled = true, .resources_folder = resources_folder};
+    if (!internal::file_watcher().has_value())
+        internal::file_watcher().emplace();
+}
+
+/// Returns nullptr if the program has been loaded from the cache, and is thus ready already.
+static auto start_building_program(GLuint program, std::vector<internal::ShaderStageSource> stages) -> std::unique_ptr<internal::PendingProgram>
+{
+    // Compiling and linking is slow (especially at startup when we create all our shaders), so we try to reuse the binary that the driver gave us last time
+    auto const cache_key = internal::program_binary_cache_key(stages);
+    if (internal::load_program_binary(program, cache_key))
+        return nullptr;
+
+    auto pending = std::make_unique<internal::PendingProgram>(internal::PendingProgram{.stages = std::move(stages), .cache_key = cache_key});
+    pending->modules.reserve(pending->stages.size());
+    for (auto const& stage : pending->stages)
+        pending->modules.emplace_back(stage);
+    for (auto const& module : pending->modules)
+        glAttachShader(program, module.id());
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    return pending;
+}
+
+static void finish_building_program(GLuint program, internal::PendingProgram const& pending)
+{
+    for (size_t i = 0; i < pending.modules.size(); ++i)
+        check_for_compilation_errors(pending.modules[i].id(), pending.stages[i].code);
+    check_for_linking_errors(program);
+    for (auto const& module : pending.modules)
+        glDetachShader(program, module.id());
+    internal::save_program_binary(program, pending.cache_key);
+}
+
+Shader::Shader(Shader_Descriptor const& desc, ShaderCompilation compilation)
+    : Shader{{{GL_VERTEX_SHADER, desc.vertex}, {GL_FRAGMENT_SHADER, desc.fragment}}, desc.defines, compilation}
+{}
+
+Shader::Shader(ComputeShader_Descriptor const& desc, ShaderCompilation compilation)
+    : Shader{{{GL_COMPUTE_SHADER, desc.compute}}, desc.defines, compilation}
+{
+    assert(compute_shaders_are_supported() && "Compute shaders require OpenGL 4.3.");
+}
+
+Shader::Shader(std::vector<internal::ShaderStageDescription> stages, std::vector<ShaderDefine> defines, ShaderCompilation compilation)
+{
+    auto sources     = read_sources(stages, defines);
+    _pending_program = start_building_program(id(), std::move(sources.stages));
+    _hot_reload      = internal::make_hot_reload_state(std::move(stages), std::move(defines), std::move(sources.files));
+    if (_pending_program == nullptr) // Loaded from the cache, so wait() will have nothing to do
+        reflect_active_uniforms();
+    if (compilation == ShaderCompilation::Blocking)
+        wait();
+    if (_hot_reload != nullptr) // Only once nothing can throw anymore, otherwise the destructor would not run and we would keep a dangling pointer
+        internal::hot_reloadable_shaders().push_back(this);
+}
+
+Shader::~Shader()
+{
+    if (_hot_reload != nullptr)
+        internal::replace_hot_reloadable_shader(this, nullptr);
+}
+
+Shader::Shader(Shader&& o) noexcept
+    : _id{std::move(o._id)}
+    , _pending_program{std::move(o._pending_program)}
+    , _hot_reload{std::move(o._hot_reload)}
+    , _uniform_locations{std::move(o._uniform_locations)}
+    , _uniform_values{std::move(o._uniform_values)}
+    , _handle_names{std::move(o._handle_names)}
+    , _location_of_handle{std::move(o._location_of_handle)}
+{
+    if (_hot_reload != nullptr)
+        internal::replace_hot_reloadable_shader(&o, this);
+}
+
+auto Shader::operator=(Shader&& o) noexcept -> Shader&
+{
+    if (this != &o)
+    {
+        if (_hot_reload != nullptr)
+            internal::replace_hot_reloadable_shader(this, nullptr);
+        _id                 = std::move(o._id);
+        _pending_program    = std::move(o._pending_program);
+        _hot_reload         = std::move(o._hot_reload);
+        _uniform_locations  = std::move(o._uniform_locations);
+        _uniform_values     = std::move(o._uniform_values);
+        _handle_names       = std::move(o._handle_names);
+        _location_of_handle = std::move(o._location_of_handle);
+        if (_hot_reload != nullptr)
+            internal::replace_hot_reloadable_shader(&o, this);
+    }
+    return *this;
+}
+
+void Shader::start_reload()
+{
+    auto& hot_reload = *_hot_reload;
+    try
+    {
+        wait(); // The current program must be done, so that we never have two pending programs
+        auto sources = read_sources(hot_reload.stages, hot_reload.defines);
+        // The #includes might have changed
+        for (auto const& file : sources.files)
+            internal::file_watcher()->watch(file);
+        hot_reload.files = std::move(sources.files);
+        hot_reload.next_program.emplace();
+        hot_reload.next_pending_program = start_building_program(hot_reload.next_program->id(), std::move(sources.stages));
+    }
+    catch (std::exception const&) // The error has already been logged by handle_error()
+    {
+        hot_reload.next_program.reset();
+        hot_reload.next_pending_program.reset();
+    }
+}
+
+void Shader::try_finish_reload()
+{
+    auto& hot_reload = *_hot_reload;
+    if (!hot_reload.next_program.has_value())
+        return;
+
+    if (hot_reload.next_pending_program != nullptr)
+    {
+        if (internal::extensions().parallel_shader_compile)
+        {
+            // Don't stall the frame: just check again next frame
+            GLint is_completed{};
+            glGetProgramiv(hot_reload.next_program->id(), GL_COMPLETION_STATUS_KHR, &is_completed);
+            if (is_completed != GL_TRUE)
+                return;
+        }
+        try
+        {
+            finish_building_program(hot_reload.next_program->id(), *hot_reload.next_pending_program);
+        }
+        catch (std::exception const&) // The error has already been logged by handle_error()
+        {
+            std::cerr << "[Shader hot reload] Keeping the previous version of the shader.\n";
+            hot_reload.next_program.reset();
+            hot_reload.next_pending_program.reset();
+            return;
+        }
+        hot_reload.next_pending_program.reset();
+    }
+
+    // Swap the programs. Everything we knew about the previous one must be updated.
+    _id = std::move(*hot_reload.next_program);
+    hot_reload.next_program.reset();
+    reflect_active_uniforms();
+    _uniform_values.clear(); // The new program has all its uniforms set to their default value
+    _location_of_handle.resize(_handle_names.size());
+    for (size_t key = 0; key < _handle_names.size(); ++key)
+        _location_of_handle[key] = _handle_names[key].empty() ? -1 : uniform_location(_handle_names[key]);
+    for (auto const& [block_name, binding_index] : hot_reload.uniform_block_bindings)
+    {
+        GLuint const block_index = glGetUniformBlockIndex(id(), block_name.c_str());
+        if (block_index != GL_INVALID_INDEX)
+            glUniformBlockBinding(id(), block_index, binding_index);
+    }
+    std::cerr << "[Shader hot reload] Reloaded a shader.\n";
+}
+
+auto Shader::is_ready() const -> bool
+{
+    if (_pending_program == nullptr)
+        return true;
+    if (!internal::extensions().parallel_shader_compile)
+        return true; // We have no way of knowing without blocking, so let the caller go ahead and block when it uses the shader
+    GLint is_completed{};
+    glGetProgramiv(id(), GL_COMPLETION_STATUS_KHR, &is_completed);
+    return is_completed == GL_TRUE;
+}
+
+void Shader::wait() const
+{
+    if (_pending_program == nullptr)
+        return;
+    auto const pending = std::move(_pending_program); // Reset it first, so that we never try to finish twice, even if finishing throws
+    finish_building_program(id(), *pending);
+    reflect_active_uniforms();
+}
+
+namespace {
+void add_to_key(std::string& key, AnyShaderSource const& source)
+{
+    if (auto const* file = std::get_if<ShaderSource::File>(&source))
+        key += "file:" + file->path.string();
+    else
+        key += "code:" + std::get<ShaderSource::Code>(source).code;
+    key += '\0';
+}
+
+auto shader_key(std::span<AnyShaderSource const> sources, std::span<ShaderDefine const> defines) -> std::string
+{
+    auto key = std::string{};
+    for (auto const& source : sources)
+        add_to_key(key, source);
+    for (auto const& define : defines)
+    {
+        key += "define:" + define.name + ' ' + define.value;
+        key += '\0';
+    }
+    return key;
+}
+
+auto shared_shaders() -> std::unordered_map<std::string, std::shared_ptr<Shader const>>&
+{
+    static auto instance = std::unordered_map<std::string, std::shared_ptr<Shader const>>{};
+    return instance;
+}
+
+template<typename Descriptor>
+auto shared_shader_impl(std::string key, Descriptor const& desc) -> std::shared_ptr<Shader const>
+{
+    auto& shaders = shared_shaders();
+    auto  it      = shaders.find(key);
+    if (it == shaders.end()) // The Shader itself must not be const, because hot reload modifies it. Only the users get a const view of it.
+        it = shaders.emplace(std::move(key), std::make_shared<Shader>(desc)).first;
+    return it->second;
+}
+} // namespace
+
+auto shared_shader(Shader_Descriptor const& desc) -> std::shared_ptr<Shader const>
+{
+    return shared_shader_impl(shader_key(std::array{desc.vertex, desc.fragment}, desc.defines), desc);
+}
+
+auto shared_shader(ComputeShader_Descriptor const& desc) -> std::shared_ptr<Shader const>
+{
+    return shared_shader_impl(shader_key(std::array{desc.compute}, desc.defines), desc);
+}
+
+auto compute_shaders_are_supported() -> bool
 {
-    auto vertex_shader   = UniqueShaderModule{GL_VERTEX_SHADER, desc.vertex};
-    auto fragment_shader = UniqueShaderModule{GL_FRAGMENT_SHADER, desc.fragment};
-    glAttachShader(id(), vertex_shader.id());
-    glAttachShader(id(), fragment_shader.id());
-    glLinkProgram(id());
-    glDetachShader(id(), fragment_shader.id());
-    glDetachShader(id(), vertex_shader.id());
-    check_for_linking_errors(id());
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+auto multi_draw_indirect_is_supported() -> bool
+{
+    return GLAD_GL_VERSION_4_3 != 0;
 }
 
 static void assert_shader_is_bound(GLuint id)
@@ -118,87 +478,287 @@ static void assert_shader_is_bound(GLuint id)
 
 void Shader::bind() const
 {
-    glUseProgram(id());
+    wait();
+    state_cache().use_program(id());
+}
+
+void Shader::dispatch(GLuint groups_count_x, GLuint groups_count_y, GLuint groups_count_z) const
+{
+    assert_shader_is_bound(id());
+    glDispatchCompute(groups_count_x, groups_count_y, groups_count_z);
+}
+
+auto Shader::uniform_block_index(std::string_view block_name) const -> GLuint
+{
+    wait();
+    GLuint const index = glGetUniformBlockIndex(id(), std::string{block_name}.c_str());
+    if (index == GL_INVALID_INDEX)
+        handle_error(std::format("There is no active uniform block named \"{}\" in this shader.", block_name));
+    return index;
+}
+
+void Shader::bind_uniform_block(std::string_view block_name, GLuint binding_index) const
+{
+    glUniformBlockBinding(id(), uniform_block_index(block_name), binding_index);
+    if (_hot_reload != nullptr)
+    {
+        auto& bindings = _hot_reload->uniform_block_bindings;
+        auto  it       = std::find_if(bindings.begin(), bindings.end(), [&](auto const& binding) { return binding.first == block_name; });
+        if (it != bindings.end())
+            it->second = binding_index;
+        else
+            bindings.emplace_back(block_name, binding_index);
+    }
+}
+
+void Shader::assert_uniform_block_has_size(std::string_view block_name, size_t size_in_bytes) const
+{
+#ifndef NDEBUG
+    GLint block_size{};
+    glGetActiveUniformBlockiv(id(), uniform_block_index(block_name), GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
+    // Drivers may or may not count the padding at the end of the block, so we only compare the sizes rounded up to a vec4
+    auto const round_up_to_vec4 = [](size_t size) { return (size + 15) / 16 * 16; };
+    assert(round_up_to_vec4(static_cast<size_t>(block_size)) == round_up_to_vec4(size_in_bytes) && "The C++ struct doesn't match the uniform block. Make sure the members are the same, and use the gl::std140 types.");
+#else
+    std::ignore = block_name;
+    std::ignore = size_in_bytes;
+#endif
+}
+
+auto Shader::uniform_is_already_set_to(GLint location, std::span<std::byte const> value) const -> bool
+{
+    if (location < 0) // OpenGL ignores these calls anyway
+        return true;
+
+    auto const index = static_cast<size_t>(location);
+    if (index >= _uniform_values.size())
+        _uniform_values.resize(index + 1);
+    auto& current = _uniform_values[index];
+    if (current.size == value.size() && std::equal(value.begin(), value.end(), current.bytes.begin()))
+    {
+        state_cache().record_skipped_call();
+        return true;
+    }
+    std::copy(value.begin(), value.end(), current.bytes.begin());
+    current.size = value.size();
+    state_cache().record_issued_call();
+    return false;
+}
+
+void Shader::reflect_active_uniforms() const
+{
+    GLint uniforms_count{};
+    GLint max_name_length{};
+    glGetProgramiv(id(), GL_ACTIVE_UNIFORMS, &uniforms_count);
+    glGetProgramiv(id(), GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+    _uniform_locations.clear();
+    auto name = std::vector<GLchar>(static_cast<size_t>(max_name_length));
+    for (GLuint i = 0; i < static_cast<GLuint>(uniforms_count); ++i)
+    {
+        GLsizei name_length{};
+        GLint   array_size{};
+        GLenum  type{};
+        glGetActiveUniform(id(), i, max_name_length, &name_length, &array_size, &type, name.data());
+        GLint const location = glGetUniformLocation(id(), name.data());
+        if (location < 0) // Uniforms that live in a uniform block don't have a location
+            continue;
+
+        auto const name_view = std::string_view{name.data(), static_cast<size_t>(name_length)};
+        _uniform_locations.push_back({std::string{name_view}, location});
+        if (name_view.ends_with("[0]")) // Arrays are reported as "my_array[0]", but can also be referred to as "my_array"
+            _uniform_locations.push_back({std::string{name_view.substr(0, name_view.size() - 3)}, location});
+    }
+    std::sort(_uniform_locations.begin(), _uniform_locations.end(), [](UniformLocation const& a, UniformLocation const& b) {
+        return a.name < b.name;
+    });
 }
 
 auto Shader::uniform_location(std::string_view uniform_name) const -> GLint
 {
-    auto const name = std::string{uniform_name};
-    auto const it   = _uniform_locations.find(name);
-    if (it != _uniform_locations.end())
+    wait();
+    auto const it = std::lower_bound(_uniform_locations.begin(), _uniform_locations.end(), uniform_name, [](UniformLocation const& uniform, std::string_view name) {
+        return uniform.name < name;
+    });
+    if (it != _uniform_locations.end() && it->name == uniform_name)
     {
-        return it->second;
+        return it->location;
     }
     else
     {
-        GLint const location     = glGetUniformLocation(id(), name.c_str());
-        _uniform_locations[name] = location;
+        // Not an active uniform (e.g. an element of an array, or a uniform that got optimized out). Ask OpenGL, and remember the answer so that we only do this once.
+        auto const  name     = std::string{uniform_name};
+        GLint const location = glGetUniformLocation(id(), name.c_str());
+        _uniform_locations.insert(it, {name, location});
         return location;
     }
 }
 
+auto Shader::uniform_handle_key(std::string_view uniform_name) const -> GLint
+{
+    GLint const location = uniform_location(uniform_name);
+    if (_hot_reload == nullptr || location < 0)
+        return location;
+
+    // We remember the name behind each handle, so that the handles can be remapped when the program is reloaded
+    if (_location_of_handle.empty())
+    {
+        // The handles are the locations themselves, until the first reload
+        auto const key = static_cast<size_t>(location);
+        if (key >= _handle_names.size())
+            _handle_names.resize(key + 1);
+        _handle_names[key] = uniform_name;
+        return location;
+    }
+    auto const it = std::find(_handle_names.begin(), _handle_names.end(), uniform_name);
+    if (it != _handle_names.end())
+        return static_cast<GLint>(it - _handle_names.begin());
+    _handle_names.emplace_back(uniform_name);
+    _location_of_handle.push_back(location);
+    return static_cast<GLint>(_handle_names.size() - 1);
+}
+
 void Shader::set_uniform(std::string_view uniform_name, int v) const
 {
-    assert_shader_is_bound(id());
-    glUniform1i(uniform_location(uniform_name), v);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, unsigned int v) const
 {
-    set_uniform(uniform_name, static_cast<int>(v));
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, bool v) const
 {
-    set_uniform(uniform_name, v ? 1 : 0);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, float v) const
 {
-    assert_shader_is_bound(id());
-    glUniform1f(uniform_location(uniform_name), v);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::vec2& v) const
 {
-    assert_shader_is_bound(id());
-    glUniform2f(uniform_location(uniform_name), v.x, v.y);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::vec3& v) const
 {
-    assert_shader_is_bound(id());
-    glUniform3f(uniform_location(uniform_name), v.x, v.y, v.z);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::vec4& v) const
 {
-    assert_shader_is_bound(id());
-    glUniform4f(uniform_location(uniform_name), v.x, v.y, v.z, v.w);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::uvec2& v) const
 {
-    assert_shader_is_bound(id());
-    glUniform2ui(uniform_location(uniform_name), v.x, v.y);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::uvec3& v) const
 {
-    assert_shader_is_bound(id());
-    glUniform3ui(uniform_location(uniform_name), v.x, v.y, v.z);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::uvec4& v) const
 {
-    assert_shader_is_bound(id());
-    glUniform4ui(uniform_location(uniform_name), v.x, v.y, v.z, v.w);
+    set_uniform_at(uniform_location(uniform_name), v);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::mat2& mat) const
 {
-    assert_shader_is_bound(id());
-    glUniformMatrix2fv(uniform_location(uniform_name), 1, GL_FALSE, glm::value_ptr(mat));
+    set_uniform_at(uniform_location(uniform_name), mat);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::mat3& mat) const
 {
-    assert_shader_is_bound(id());
-    glUniformMatrix3fv(uniform_location(uniform_name), 1, GL_FALSE, glm::value_ptr(mat));
+    set_uniform_at(uniform_location(uniform_name), mat);
 }
 void Shader::set_uniform(std::string_view uniform_name, const glm::mat4& mat) const
+{
+    set_uniform_at(uniform_location(uniform_name), mat);
+}
+void Shader::set_uniform(std::string_view uniform_name, Texture const& texture) const
+{
+    set_uniform_at(uniform_location(uniform_name), texture);
+}
+
+void Shader::set_uniform_at(GLint location, int v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform1i(location, v);
+}
+void Shader::set_uniform_at(GLint location, unsigned int v) const
+{
+    set_uniform_at(location, static_cast<int>(v));
+}
+void Shader::set_uniform_at(GLint location, bool v) const
+{
+    set_uniform_at(location, v ? 1 : 0);
+}
+void Shader::set_uniform_at(GLint location, float v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform1f(location, v);
+}
+void Shader::set_uniform_at(GLint location, const glm::vec2& v) const
 {
     assert_shader_is_bound(id());
-    glUniformMatrix4fv(uniform_location(uniform_name), 1, GL_FALSE, glm::value_ptr(mat));
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform2f(location, v.x, v.y);
+}
+void Shader::set_uniform_at(GLint location, const glm::vec3& v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform3f(location, v.x, v.y, v.z);
+}
+void Shader::set_uniform_at(GLint location, const glm::vec4& v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform4f(location, v.x, v.y, v.z, v.w);
+}
+void Shader::set_uniform_at(GLint location, const glm::uvec2& v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform2ui(location, v.x, v.y);
+}
+void Shader::set_uniform_at(GLint location, const glm::uvec3& v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform3ui(location, v.x, v.y, v.z);
+}
+void Shader::set_uniform_at(GLint location, const glm::uvec4& v) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, v))
+        return;
+    glUniform4ui(location, v.x, v.y, v.z, v.w);
+}
+void Shader::set_uniform_at(GLint location, const glm::mat2& mat) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, mat))
+        return;
+    glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+void Shader::set_uniform_at(GLint location, const glm::mat3& mat) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, mat))
+        return;
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+void Shader::set_uniform_at(GLint location, const glm::mat4& mat) const
+{
+    assert_shader_is_bound(id());
+    if (uniform_is_already_set_to(location, mat))
+        return;
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
 static auto max_number_of_texture_slots() -> GLuint
@@ -219,13 +779,17 @@ static auto get_next_texture_slot() -> GLuint
     return current_slot;
 }
 
-void Shader::set_uniform(std::string_view uniform_name, Texture const& texture) const
+void Shader::set_uniform_at(GLint location, Texture const& texture) const
 {
-    auto const slot = get_next_texture_slot();
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(GL_TEXTURE_2D, texture.id());
-    set_uniform(uniform_name, slot);
-    glActiveTexture(GL_TEXTURE0); // HACK Slot 0 is used for texture operations like resizing and setting the image, anyone might override the texture set here at any time. So we use all slots but the 0th one for rendering.
+    auto& cache = state_cache();
+    // If the texture is still bound from a previous call we reuse its slot, so that neither the binding nor the uniform have to change
+    auto slot = cache.rendering_unit_of(GL_TEXTURE_2D, texture.id());
+    if (!slot.has_value())
+    {
+        slot = get_next_texture_slot();
+        cache.bind_texture(*slot, GL_TEXTURE_2D, texture.id());
+    }
+    set_uniform_at(location, static_cast<int>(*slot));
 }
 
 // void Shader::set_uniform_texture(std::string_view uniform_name, GLuint texture_id, TextureSamplerDescriptor const& sampler) const
@@ -1,9 +1,15 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <filesystem>
+#include <memory>
+#include <span>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <type_traits>
 #include <variant>
+#include <vector>
+#include "ShaderPreprocessor.hpp"
 #include "Texture.hpp"
 #include "glad/gl.h"
 #include "glm/glm.hpp"
@@ -43,6 +49,9 @@ public:
 private:
     GLuint _id;
 };
+struct PendingProgram;
+struct HotReloadState;
+void reload_changed_shaders();
 } // namespace internal
 
 namespace ShaderSource {
@@ -58,18 +67,86 @@ using AnyShaderSource = std::variant<
     ShaderSource::File,
     ShaderSource::Code>;
 
+/// The sources can `#include "path/to/file.glsl"`. Relative paths are resolved like ShaderSource::File, i.e. relative to the folder of the executable (see make_absolute_path()).
+/// Each file is included only once, and is watched too when hot reload is enabled.
 struct Shader_Descriptor {
-    AnyShaderSource vertex{};
-    AnyShaderSource fragment{};
+    AnyShaderSource           vertex{};
+    AnyShaderSource           fragment{};
+    std::vector<ShaderDefine> defines{}; // Lets you compile several variants of the same code, with #if in the shader instead of branching on a uniform at runtime
 };
 
+struct ComputeShader_Descriptor {
+    AnyShaderSource           compute{};
+    std::vector<ShaderDefine> defines{};
+};
+
+namespace internal {
+struct ShaderStageDescription {
+    GLenum          kind{};
+    AnyShaderSource source{};
+};
+} // namespace internal
+
+/// A uniform whose location has been looked up once and for all. Get one with `shader.uniform<T>("name")`, and then use it with `shader.set_uniform(handle, value)`.
+/// This is cheaper than setting the uniform by name, because there is no lookup at all.
+template<typename T>
+class UniformHandle {
+public:
+    /// NB: once a hot reloadable shader has been reloaded, this is not the location in the current program anymore, but the Shader still knows what it refers to.
+    auto location() const -> GLint { return _location; }
+
+private:
+    friend class Shader;
+    explicit UniformHandle(GLint location)
+        : _location{location}
+    {}
+
+private:
+    GLint _location{-1};
+};
+
+/// Compute shaders require OpenGL 4.3, which is not available on MacOS.
+auto compute_shaders_are_supported() -> bool;
+/// glMultiDrawElementsIndirect() requires OpenGL 4.3 too. Without it, MeshPool issues one draw call per mesh.
+auto multi_draw_indirect_is_supported() -> bool;
+
+/// From now on, the shaders created from ShaderSource::File are watched and recompiled whenever one of their files changes. If the new version fails to compile, the previous one is kept.
+/// Recompilation happens in gl::window_is_open(), and only blocks the frame if the driver doesn't support GL_KHR_parallel_shader_compile.
+/// Relative paths are looked up in `resources_folder` first (for example the res/ folder of your sources, instead of the copy next to the executable), and then next to the executable as usual.
+void enable_shaders_hot_reload(std::filesystem::path const& resources_folder = {});
+
+enum class ShaderCompilation {
+    /// The constructor waits until the shader is compiled and linked, and reports errors right away.
+    Blocking,
+    /// The constructor only submits the work to the driver. Creating all your shaders this way, and only then using them, allows the driver to compile them in parallel.
+    /// The shader then waits for the compilation to be done the first time you use it (bind(), uniform(), ...), and reports errors at that point. See also is_ready() and wait().
+    Async,
+};
+
+/// NB: don't create a Shader as a const object (e.g. `static auto const shader = gl::Shader{...}`): hot reload modifies it behind the scenes, which is undefined behaviour on a const object. A const reference to it is fine.
 class Shader {
 public:
-    explicit Shader(Shader_Descriptor const&);
+    explicit Shader(Shader_Descriptor const&, ShaderCompilation = ShaderCompilation::Blocking);
+    explicit Shader(ComputeShader_Descriptor const&, ShaderCompilation = ShaderCompilation::Blocking);
+    ~Shader();
+    Shader(Shader const&)                    = delete;
+    auto operator=(Shader const&) -> Shader& = delete;
+    Shader(Shader&&) noexcept;
+    auto operator=(Shader&&) noexcept -> Shader&;
 
+    /// NB: with ShaderCompilation::Async the program might not be linked yet, call wait() before using the id directly.
     auto id() const -> GLuint { return _id.id(); }
 
+    /// Returns true if using the shader will not block. Never blocks itself.
+    /// This can only be known when the driver supports GL_KHR_parallel_shader_compile. Otherwise this always returns true.
+    auto is_ready() const -> bool;
+    /// Blocks until the shader is compiled and linked. This is done automatically when you first use the shader.
+    void wait() const;
+
     void bind() const;
+    /// Only valid for a Shader created from a ComputeShader_Descriptor. You must bind() the shader first.
+    /// NB: this doesn't wait for the compute shader to be done. Use glMemoryBarrier() before reading what it wrote.
+    void dispatch(GLuint groups_count_x, GLuint groups_count_y = 1, GLuint groups_count_z = 1) const;
     void set_uniform(std::string_view uniform_name, int) const;
     void set_uniform(std::string_view uniform_name, unsigned int) const;
     void set_uniform(std::string_view uniform_name, bool) const;
@@ -85,12 +162,95 @@ public:
     void set_uniform(std::string_view uniform_name, glm::mat4 const&) const;
     void set_uniform(std::string_view uniform_name, Texture const&) const;
 
+    /// Connects the `uniform block_name {...}` block to the buffer that is bound to `binding_index`, see UniformBuffer::bind() and UniformBufferRange::bind().
+    /// This is the equivalent of `layout(binding = binding_index)`, which is not available before GLSL 4.20.
+    void bind_uniform_block(std::string_view block_name, GLuint binding_index) const;
+    /// Same, but also checks (in debug) that `Block` has the same size as the block in the shader, which catches most mistakes with the std140 layout.
+    template<typename Block>
+    void bind_uniform_block(std::string_view block_name, GLuint binding_index) const
+    {
+        assert_uniform_block_has_size(block_name, sizeof(Block));
+        bind_uniform_block(block_name, binding_index);
+    }
+
+    /// Looks the uniform up once, so that you can then set it each frame without paying for the lookup.
+    template<typename T>
+    auto uniform(std::string_view uniform_name) const -> UniformHandle<T>
+    {
+        return UniformHandle<T>{uniform_handle_key(uniform_name)};
+    }
+    template<typename T>
+    void set_uniform(UniformHandle<T> uniform, std::type_identity_t<T> const& value) const
+    {
+        set_uniform_at(location_of_handle(uniform.location()), value);
+    }
+
 private:
+    Shader(std::vector<internal::ShaderStageDescription> stages, std::vector<ShaderDefine> defines, ShaderCompilation);
+
+    friend void internal::reload_changed_shaders();
+    void start_reload();
+    void try_finish_reload();
+
+    auto uniform_handle_key(std::string_view uniform_name) const -> GLint;
+    auto location_of_handle(GLint key) const -> GLint
+    {
+        if (_location_of_handle.empty() || key < 0) // Until the first reload, the handles are the locations themselves
+            return key;
+        return _location_of_handle[static_cast<size_t>(key)];
+    }
+
     auto uniform_location(std::string_view uniform_name) const -> GLint;
+    void reflect_active_uniforms() const;
+    auto uniform_block_index(std::string_view block_name) const -> GLuint;
+    void assert_uniform_block_has_size(std::string_view block_name, size_t size_in_bytes) const;
+    /// Returns true iff the uniform already has this value. Otherwise remembers it, and the caller must then actually set it.
+    auto uniform_is_already_set_to(GLint location, std::span<std::byte const> value) const -> bool;
+    template<typename T>
+    auto uniform_is_already_set_to(GLint location, T const& value) const -> bool
+    {
+        return uniform_is_already_set_to(location, std::as_bytes(std::span{&value, 1}));
+    }
+
+    void set_uniform_at(GLint location, int) const;
+    void set_uniform_at(GLint location, unsigned int) const;
+    void set_uniform_at(GLint location, bool) const;
+    void set_uniform_at(GLint location, float) const;
+    void set_uniform_at(GLint location, glm::vec2 const&) const;
+    void set_uniform_at(GLint location, glm::vec3 const&) const;
+    void set_uniform_at(GLint location, glm::vec4 const&) const;
+    void set_uniform_at(GLint location, glm::uvec2 const&) const;
+    void set_uniform_at(GLint location, glm::uvec3 const&) const;
+    void set_uniform_at(GLint location, glm::uvec4 const&) const;
+    void set_uniform_at(GLint location, glm::mat2 const&) const;
+    void set_uniform_at(GLint location, glm::mat3 const&) const;
+    void set_uniform_at(GLint location, glm::mat4 const&) const;
+    void set_uniform_at(GLint location, Texture const&) const;
+
+private:
+    struct UniformLocation {
+        std::string name;
+        GLint       location;
+    };
+    struct UniformValue {
+        std::array<std::byte, sizeof(glm::mat4)> bytes{};
+        size_t                                   size{}; // 0 until the uniform has been set through this Shader
+    };
 
 private:
-    internal::UniqueShader                         _id{};
-    mutable std::unordered_map<std::string, GLint> _uniform_locations{};
+    internal::UniqueShader                            _id{};
+    mutable std::unique_ptr<internal::PendingProgram> _pending_program{};    // nullptr once the program is ready
+    std::unique_ptr<internal::HotReloadState>         _hot_reload{};         // nullptr unless the shader is hot reloadable
+    mutable std::vector<UniformLocation>              _uniform_locations{};  // Sorted by name, so that we can binary search it without hashing nor allocating a std::string
+    mutable std::vector<UniformValue>                 _uniform_values{};     // Indexed by location. Lets us skip the glUniform*() calls that would not change anything
+    mutable std::vector<std::string>                  _handle_names{};       // Indexed by UniformHandle::location(). Only filled for hot reloadable shaders
+    mutable std::vector<GLint>                        _location_of_handle{}; // Indexed by UniformHandle::location(). Empty until the first reload
 };
 
+/// Compiles each variant (same sources and same defines) only once, and returns the same Shader to everyone who asks for it.
+/// This is how you should get the variants of a shader that uses defines: a variant that has already been requested costs nothing.
+/// The shaders are kept alive until the end of the program.
+auto shared_shader(Shader_Descriptor const&) -> std::shared_ptr<Shader const>;
+auto shared_shader(ComputeShader_Descriptor const&) -> std::shared_ptr<Shader const>;
+
 } // namespace gl
\ No newline at end of file
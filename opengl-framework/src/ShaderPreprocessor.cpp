@@ -0,0 +1,126 @@
+#include "ShaderPreprocessor.hpp"
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include "handle_error.hpp"
+
+namespace gl::internal {
+
+namespace {
+
+auto trim_start(std::string_view str) -> std::string_view
+{
+    auto const first = str.find_first_not_of(" \t");
+    return first == std::string_view::npos ? std::string_view{} : str.substr(first);
+}
+
+/// Returns the name of the directive if the line is one (e.g. "include" for `  # include "file.glsl"`), and puts the rest of the line in `arguments`.
+auto directive_name(std::string_view line, std::string_view& arguments) -> std::string_view
+{
+    line = trim_start(line);
+    if (!line.starts_with('#'))
+        return {};
+    line                 = trim_start(line.substr(1));
+    auto const name_size = std::min(line.find_first_of(" \t"), line.size());
+    arguments            = trim_start(line.substr(name_size));
+    return line.substr(0, name_size);
+}
+
+auto included_path(std::string_view arguments) -> std::filesystem::path
+{
+    auto const first = arguments.find('"');
+    auto const last  = arguments.find('"', first + 1);
+    if (first != 0 || last == std::string_view::npos)
+        handle_error(std::format("[Shader preprocessor] Invalid #include {}. The path must be written between double quotes, like #include \"res/my_file.glsl\".", arguments));
+    return std::filesystem::path{arguments.substr(1, last - 1)};
+}
+
+class Preprocessor {
+public:
+    explicit Preprocessor(std::function<std::filesystem::path(std::filesystem::path const&)> const& resolve_path)
+        : _resolve_path{resolve_path}
+    {}
+
+    /// `defines` is only used for the top-level code: the #version line must be the very first one, so the defines go right after it.
+    void process(std::string_view code, size_t source_string_number, std::span<ShaderDefine const> defines)
+    {
+        bool   defines_are_injected = defines.empty();
+        size_t line_number          = 0;
+        while (!code.empty())
+        {
+            auto const line_size = std::min(code.find('\n'), code.size());
+            auto const line      = code.substr(0, line_size);
+            code.remove_prefix(std::min(line_size + 1, code.size()));
+            line_number++;
+
+            auto       arguments = std::string_view{};
+            auto const directive = directive_name(line, arguments);
+            if (!defines_are_injected && directive != "version" && !trim_start(line).empty() && !trim_start(line).starts_with("//"))
+            {
+                // There is no #version line, so we can inject the defines right before the first line of code
+                inject(defines, line_number, source_string_number);
+                defines_are_injected = true;
+            }
+            if (directive == "include")
+            {
+                include(included_path(arguments));
+                // Go back to the numbering of the current file
+                _result.code += std::format("#line {} {}\n", line_number + 1, source_string_number);
+                continue;
+            }
+            _result.code += line;
+            _result.code += '\n';
+            if (!defines_are_injected && directive == "version")
+            {
+                inject(defines, line_number + 1, source_string_number);
+                defines_are_injected = true;
+            }
+        }
+    }
+
+    auto result() && -> PreprocessedShader { return std::move(_result); }
+
+private:
+    void include(std::filesystem::path const& path)
+    {
+        auto const absolute_path = _resolve_path(path).lexically_normal();
+        if (std::find(_result.included_files.begin(), _result.included_files.end(), absolute_path) != _result.included_files.end())
+            return; // Already included. This also protects us against files that include each other.
+
+        auto file = std::ifstream{absolute_path};
+        if (!file)
+            handle_error(std::format("[Shader preprocessor] Failed to open included file \"{}\".", absolute_path.string()));
+        auto const code = std::string{std::istreambuf_iterator<char>{file}, {}};
+
+        _result.included_files.push_back(absolute_path);
+        size_t const source_string_number = _result.included_files.size();
+        _result.code += std::format("#line 1 {}\n", source_string_number);
+        process(code, source_string_number, {});
+    }
+
+    void inject(std::span<ShaderDefine const> defines, size_t next_line_number, size_t source_string_number)
+    {
+        for (auto const& define : defines)
+            _result.code += std::format("#define {} {}\n", define.name, define.value);
+        _result.code += std::format("#line {} {}\n", next_line_number, source_string_number);
+    }
+
+private:
+    std::function<std::filesystem::path(std::filesystem::path const&)> const& _resolve_path;
+    PreprocessedShader                                                         _result{};
+};
+
+} // namespace
+
+auto preprocess_shader(
+    std::string_view                                                          code,
+    std::span<ShaderDefine const>                                             defines,
+    std::function<std::filesystem::path(std::filesystem::path const&)> const& resolve_path
+) -> PreprocessedShader
+{
+    auto preprocessor = Preprocessor{resolve_path};
+    preprocessor.process(code, 0, defines);
+    return std::move(preprocessor).result();
+}
+
+} // namespace gl::internal
@@ -0,0 +1,35 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gl {
+
+/// Injected as `#define name value` at the top of each stage of the shader, just after the #version line.
+struct ShaderDefine {
+    std::string name{};
+    std::string value{"1"};
+};
+
+namespace internal {
+
+struct PreprocessedShader {
+    std::string                        code{};
+    std::vector<std::filesystem::path> included_files{};
+};
+
+/// Injects the defines, and replaces each `#include "path"` with the content of that file (each file is included at most once, like with #pragma once).
+/// `resolve_path` turns the path written in the #include into the absolute path of the file.
+/// #line directives are added around the included code, so that compilation errors report the right line. The "source string number" of an included file is its index in `included_files` plus 1.
+auto preprocess_shader(
+    std::string_view                                                          code,
+    std::span<ShaderDefine const>                                             defines,
+    std::function<std::filesystem::path(std::filesystem::path const&)> const& resolve_path
+) -> PreprocessedShader;
+
+} // namespace internal
+
+} // namespace gl
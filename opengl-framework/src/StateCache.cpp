@@ -0,0 +1,161 @@
+#include "StateCache.hpp"
+
+namespace gl {
+
+auto StateCache::skip_if(bool already_set) -> bool
+{
+    if (already_set)
+        _skipped_calls_count++;
+    else
+        _issued_calls_count++;
+    return already_set;
+}
+
+void StateCache::use_program(GLuint program)
+{
+    if (skip_if(_program == program))
+        return;
+    glUseProgram(program);
+    _program = program;
+}
+
+void StateCache::bind_vertex_array(GLuint vertex_array)
+{
+    if (skip_if(_vertex_array == vertex_array))
+        return;
+    glBindVertexArray(vertex_array);
+    _vertex_array = vertex_array;
+}
+
+void StateCache::set_active_texture_unit(GLuint unit)
+{
+    if (skip_if(_active_texture_unit == unit))
+        return;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    _active_texture_unit = unit;
+}
+
+void StateCache::bind_texture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (unit >= _textures.size())
+        _textures.resize(unit + 1);
+    auto& bound = _textures[unit];
+    // Even if the texture is already bound we still activate its unit, because the caller might be about to modify the texture
+    set_active_texture_unit(unit);
+    if (skip_if(bound.has_value() && bound->target == target && bound->texture == texture))
+        return;
+    glBindTexture(target, texture);
+    bound = BoundTexture{.target = target, .texture = texture};
+}
+
+auto StateCache::rendering_unit_of(GLenum target, GLuint texture) const -> std::optional<GLuint>
+{
+    for (size_t unit = 1; unit < _textures.size(); ++unit)
+    {
+        if (_textures[unit].has_value() && _textures[unit]->target == target && _textures[unit]->texture == texture)
+            return static_cast<GLuint>(unit);
+    }
+    return std::nullopt;
+}
+
+void StateCache::bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+    bool const sets_draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool const sets_read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if (skip_if((!sets_draw || _draw_framebuffer == framebuffer) && (!sets_read || _read_framebuffer == framebuffer)))
+        return;
+    glBindFramebuffer(target, framebuffer);
+    if (sets_draw)
+        _draw_framebuffer = framebuffer;
+    if (sets_read)
+        _read_framebuffer = framebuffer;
+}
+
+auto StateCache::draw_framebuffer() -> GLuint
+{
+    if (!_draw_framebuffer.has_value())
+    {
+        GLint id{};
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &id);
+        _draw_framebuffer = static_cast<GLuint>(id);
+    }
+    return *_draw_framebuffer;
+}
+
+auto StateCache::read_framebuffer() -> GLuint
+{
+    if (!_read_framebuffer.has_value())
+    {
+        GLint id{};
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &id);
+        _read_framebuffer = static_cast<GLuint>(id);
+    }
+    return *_read_framebuffer;
+}
+
+void StateCache::set_viewport(glm::ivec4 const& viewport)
+{
+    if (skip_if(_viewport == viewport))
+        return;
+    glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+    _viewport = viewport;
+}
+
+auto StateCache::viewport() -> glm::ivec4
+{
+    if (!_viewport.has_value())
+    {
+        glm::ivec4 viewport{};
+        glGetIntegerv(GL_VIEWPORT, &viewport.x);
+        _viewport = viewport;
+    }
+    return *_viewport;
+}
+
+void StateCache::forget_vertex_array(GLuint vertex_array)
+{
+    if (_vertex_array == vertex_array)
+        _vertex_array = 0; // Deleting the bound vertex array binds 0 instead
+}
+
+void StateCache::forget_texture(GLuint texture)
+{
+    for (auto& bound : _textures)
+    {
+        if (bound.has_value() && bound->texture == texture)
+            bound->texture = 0; // Deleting a texture unbinds it from all the units
+    }
+}
+
+void StateCache::forget_framebuffer(GLuint framebuffer)
+{
+    if (_draw_framebuffer == framebuffer)
+        _draw_framebuffer = 0; // Deleting the bound framebuffer binds the default one instead
+    if (_read_framebuffer == framebuffer)
+        _read_framebuffer = 0;
+}
+
+void StateCache::invalidate()
+{
+    _program.reset();
+    _vertex_array.reset();
+    _active_texture_unit.reset();
+    _textures.clear();
+    _draw_framebuffer.reset();
+    _read_framebuffer.reset();
+    _viewport.reset();
+}
+
+void StateCache::reset_counters()
+{
+    _issued_calls_count  = 0;
+    _skipped_calls_count = 0;
+}
+
+auto state_cache() -> StateCache&
+{
+    static auto instance = StateCache{};
+    return instance;
+}
+
+} // namespace gl
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "glad/gl.h"
+#include "glm/glm.hpp"
+
+namespace gl {
+
+/// Remembers the OpenGL state that we have set, so that we can skip the calls that would set it to the value it already has.
+/// All the classes of the framework go through it. If you change some of this state with raw OpenGL calls, call invalidate() afterwards.
+class StateCache {
+public:
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint vertex_array);
+    /// Also makes `unit` the active texture unit.
+    void bind_texture(GLuint unit, GLenum target, GLuint texture);
+    /// Returns the texture unit to which `texture` is currently bound, if any. Unit 0 is never returned, see Shader::set_uniform(Texture).
+    auto rendering_unit_of(GLenum target, GLuint texture) const -> std::optional<GLuint>;
+    /// `target` can be GL_FRAMEBUFFER (binds both the draw and read framebuffers), GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER.
+    void bind_framebuffer(GLenum target, GLuint framebuffer);
+    auto draw_framebuffer() -> GLuint;
+    auto read_framebuffer() -> GLuint;
+    void set_viewport(glm::ivec4 const& viewport);
+    auto viewport() -> glm::ivec4;
+
+    /// Used by Shader, which keeps track of its own uniform values.
+    void record_issued_call() { _issued_calls_count++; }
+    void record_skipped_call() { _skipped_calls_count++; }
+
+    /// Must be called when an object is deleted, because OpenGL unbinds it and the name might then be reused by a new object.
+    void forget_vertex_array(GLuint vertex_array);
+    void forget_texture(GLuint texture);
+    void forget_framebuffer(GLuint framebuffer);
+
+    /// Forgets everything we know about the current state. The next calls will all be issued.
+    void invalidate();
+
+    auto issued_calls_count() const -> size_t { return _issued_calls_count; }
+    auto skipped_calls_count() const -> size_t { return _skipped_calls_count; }
+    void reset_counters();
+
+private:
+    struct BoundTexture {
+        GLenum target{};
+        GLuint texture{};
+    };
+
+    void set_active_texture_unit(GLuint unit);
+    auto skip_if(bool already_set) -> bool;
+
+private:
+    std::optional<GLuint>                    _program{};
+    std::optional<GLuint>                    _vertex_array{};
+    std::optional<GLuint>                    _active_texture_unit{};
+    std::vector<std::optional<BoundTexture>> _textures{}; // Indexed by texture unit
+    std::optional<GLuint>                    _draw_framebuffer{};
+    std::optional<GLuint>                    _read_framebuffer{};
+    std::optional<glm::ivec4>                _viewport{};
+
+    size_t _issued_calls_count{};
+    size_t _skipped_calls_count{};
+};
+
+/// The cache of the one and only OpenGL context.
+auto state_cache() -> StateCache&;
+
+} // namespace gl
@@ -24,7 +24,7 @@ static void upload_image_data(TextureSource::File const& source)
 
 Texture::Texture(AnyTextureSource const& source, TextureOptions const& options)
 {
-    glBindTexture(GL_TEXTURE_2D, _id.id());
+    state_cache().bind_texture(0, GL_TEXTURE_2D, _id.id()); // Slot 0 is reserved for texture operations, see Shader::set_uniform(Texture)
     std::visit([&](auto&& source) { upload_image_data(source); }, source);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(options.minification_filter));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(options.magnification_filter));
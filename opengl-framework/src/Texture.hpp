@@ -2,6 +2,7 @@
 #include <filesystem>
 #include <span>
 #include <variant>
+#include "StateCache.hpp"
 #include "glad/gl.h"
 #include "glm/glm.hpp"
 
@@ -307,6 +308,7 @@ public:
     }
     ~UniqueTexture()
     {
+        state_cache().forget_texture(_id);
         glDeleteTextures(1, &_id);
     }
     UniqueTexture(UniqueTexture const&)                    = delete; // You cannot copy
@@ -320,6 +322,7 @@ public:
     {
         if (&o != this)
         {
+            state_cache().forget_texture(_id);
             glDeleteTextures(1, &_id);
             _id   = o._id;
             o._id = 0;
@@ -0,0 +1,163 @@
+#include "UniformBuffer.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <optional>
+#include "extensions.hpp"
+#include "handle_error.hpp"
+
+namespace gl {
+
+void UniformBufferRange::bind(GLuint binding_index) const
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding_index, buffer_id, static_cast<GLintptr>(offset_in_bytes), static_cast<GLsizeiptr>(size_in_bytes));
+}
+
+static auto uniform_buffer_offset_alignment() -> size_t
+{
+    GLint res{};
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &res);
+    return static_cast<size_t>(res);
+}
+
+static auto round_up(size_t value, size_t alignment) -> size_t
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UniformRingBuffer::UniformRingBuffer(size_t bytes_per_frame, size_t frames_in_flight)
+    : _offset_alignment{uniform_buffer_offset_alignment()}
+    , _bytes_per_frame{round_up(bytes_per_frame, _offset_alignment)}
+{
+    assert(frames_in_flight > 0);
+    _fences.resize(frames_in_flight, nullptr);
+    allocate_buffer(_bytes_per_frame * frames_in_flight);
+}
+
+void UniformRingBuffer::allocate_buffer(size_t size_in_bytes)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer.id()); // GL_COPY_WRITE_BUFFER is not used by any draw call, so binding to it doesn't mess with the state of the rest of the app
+    if (!internal::extensions().buffer_storage)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size_in_bytes), nullptr, GL_STREAM_DRAW);
+        _mapping = nullptr;
+        return;
+    }
+    // The fences already prevent us from writing to a region that the GPU is reading, so the mapping can stay alive all the time.
+    // And it is coherent, so the GPU sees what we write without us having to flush anything.
+    GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    internal::extensions().glBufferStorage(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size_in_bytes), nullptr, flags);
+    _mapping = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(size_in_bytes), flags));
+    if (_mapping == nullptr)
+        handle_error("[UniformRingBuffer] Failed to map the buffer.");
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    for (GLsync fence : _fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    }
+}
+
+void UniformRingBuffer::wait_until_current_region_is_free()
+{
+    GLsync& fence = _fences[_current_region];
+    if (fence != nullptr)
+    {
+        // Typically already signaled, unless the CPU is more than frames_in_flight frames ahead of the GPU
+        GLenum result = GL_TIMEOUT_EXPIRED;
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000 /*nanoseconds*/);
+        if (result == GL_WAIT_FAILED)
+            handle_error("[UniformRingBuffer] Failed to wait for the GPU to be done with the buffer.");
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    _current_region_is_free = true;
+}
+
+auto UniformRingBuffer::push(std::span<std::byte const> block) -> UniformBufferRange
+{
+    if (!_current_region_is_free)
+        wait_until_current_region_is_free();
+
+    size_t offset = round_up(_offset_in_region, _offset_alignment);
+    if (offset + block.size() > _bytes_per_frame)
+    {
+        grow(std::max(2 * _bytes_per_frame, block.size()));
+        offset = 0;
+    }
+    _offset_in_region = offset + block.size();
+
+    auto const offset_in_buffer = _current_region * _bytes_per_frame + offset;
+    if (_mapping != nullptr)
+    {
+        std::memcpy(_mapping + offset_in_buffer, block.data(), block.size()); // NOLINT(*pointer-arithmetic)
+        return {.buffer_id = _buffer.id(), .offset_in_bytes = offset_in_buffer, .size_in_bytes = block.size()};
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer.id());
+    // We know that the GPU is not using this part of the buffer (see wait_until_current_region_is_free()), so we tell the driver not to synchronize
+    void* const destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset_in_buffer), static_cast<GLsizeiptr>(block.size()), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (destination == nullptr)
+        handle_error("[UniformRingBuffer] Failed to map the buffer.");
+    std::memcpy(destination, block.data(), block.size());
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+
+    return {.buffer_id = _buffer.id(), .offset_in_bytes = offset_in_buffer, .size_in_bytes = block.size()};
+}
+
+void UniformRingBuffer::grow(size_t min_bytes_per_frame)
+{
+    // The ranges already pushed this frame might not have been drawn yet, so we keep the old buffer alive until the next frame (deleting it will also unmap it)
+    _retired_buffers.push_back(std::move(_buffer));
+    _bytes_per_frame = round_up(min_bytes_per_frame, _offset_alignment);
+    _buffer          = internal::UniqueBuffer{};
+    allocate_buffer(_bytes_per_frame * _fences.size());
+    for (GLsync& fence : _fences) // The new buffer is not used by the GPU yet
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void UniformRingBuffer::next_frame()
+{
+    if (_offset_in_region != 0)
+    {
+        assert(_fences[_current_region] == nullptr);
+        _fences[_current_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    _current_region         = (_current_region + 1) % _fences.size();
+    _offset_in_region       = 0;
+    _current_region_is_free = false;
+    _retired_buffers.clear();
+}
+
+static auto ring_buffer_storage() -> std::optional<UniformRingBuffer>&
+{
+    static auto instance = std::optional<UniformRingBuffer>{};
+    return instance;
+}
+
+auto uniform_ring_buffer() -> UniformRingBuffer&
+{
+    auto& instance = ring_buffer_storage();
+    if (!instance.has_value())
+        instance.emplace();
+    return *instance;
+}
+
+namespace internal {
+void advance_uniform_ring_buffer()
+{
+    auto& instance = ring_buffer_storage();
+    if (instance.has_value())
+        instance->next_frame();
+}
+} // namespace internal
+
+} // namespace gl
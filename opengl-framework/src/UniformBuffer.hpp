@@ -0,0 +1,151 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "Buffer.hpp"
+#include "glad/gl.h"
+#include "glm/glm.hpp"
+
+namespace gl {
+
+/// Types that have the size and alignment that the std140 layout gives them in GLSL, so that a C++ struct made of them matches a `layout(std140) uniform MyBlock {...}` declared with the same members in the same order.
+/// Scalars (float, int, unsigned int) already match and can be used as is. Booleans must be declared as int in C++.
+/// NB: in GLSL a scalar can be packed just after a vec3, in the same 16 bytes. Our vec3 is padded to 16 bytes, so if you want that packing use `alignas(16) glm::vec3` followed by the scalar instead.
+namespace std140 {
+
+struct alignas(8) vec2 : glm::vec2 {
+    using glm::vec2::vec2;
+    vec2(glm::vec2 const& v) // NOLINT(*explicit*)
+        : glm::vec2{v}
+    {}
+};
+
+struct alignas(16) vec3 : glm::vec3 {
+    using glm::vec3::vec3;
+    vec3(glm::vec3 const& v) // NOLINT(*explicit*)
+        : glm::vec3{v}
+    {}
+};
+
+struct alignas(16) vec4 : glm::vec4 {
+    using glm::vec4::vec4;
+    vec4(glm::vec4 const& v) // NOLINT(*explicit*)
+        : glm::vec4{v}
+    {}
+};
+
+struct alignas(16) mat4 : glm::mat4 {
+    using glm::mat4::mat4;
+    mat4(glm::mat4 const& m) // NOLINT(*explicit*)
+        : glm::mat4{m}
+    {}
+};
+
+/// Each column of a mat3 is padded to a vec4.
+struct alignas(16) mat3 {
+    std::array<glm::vec4, 3> columns{};
+
+    mat3() = default;
+    mat3(glm::mat3 const& m) // NOLINT(*explicit*)
+        : columns{glm::vec4{m[0], 0.f}, glm::vec4{m[1], 0.f}, glm::vec4{m[2], 0.f}}
+    {}
+};
+
+/// Each element of an array is padded to a vec4.
+template<typename T, size_t N>
+struct alignas(16) array {
+    struct alignas(16) Element {
+        T value{};
+    };
+    std::array<Element, N> elements{};
+
+    auto operator[](size_t i) -> T& { return elements[i].value; }
+    auto operator[](size_t i) const -> T const& { return elements[i].value; }
+};
+
+} // namespace std140
+
+/// A slice of a buffer that can be bound to a uniform block.
+struct UniformBufferRange {
+    GLuint buffer_id{};
+    size_t offset_in_bytes{};
+    size_t size_in_bytes{};
+
+    /// Makes the range available to the shaders, as the uniform block that has been bound to `binding_index` (see Shader::bind_uniform_block()).
+    void bind(GLuint binding_index) const;
+};
+
+/// Holds one instance of `Block` in GPU memory. Typically used for values that are shared by all the shaders and all the draw calls of a frame, like the camera or the lights.
+/// `Block` must be a struct whose layout matches the std140 layout of the GLSL block, see the gl::std140 types.
+template<typename Block>
+class UniformBuffer {
+    static_assert(std::is_trivially_copyable_v<Block>, "A uniform block is copied byte by byte to the GPU.");
+
+public:
+    explicit UniformBuffer(Block const& block = {})
+        : _buffer{std::span{&block, 1}, BufferUsage::Dynamic}
+    {}
+
+    void set(Block const& block) { _buffer.set_data(std::span{&block, 1}); }
+    void bind(GLuint binding_index) const { range().bind(binding_index); }
+
+    auto range() const -> UniformBufferRange { return {.buffer_id = _buffer.id(), .offset_in_bytes = 0, .size_in_bytes = sizeof(Block)}; }
+    auto buffer() const -> Buffer const& { return _buffer; }
+
+private:
+    Buffer _buffer;
+};
+
+/// Sub-allocates short-lived uniform blocks (typically one per draw call) from one big buffer, instead of creating / updating a buffer for each of them.
+/// The buffer is split in `frames_in_flight` regions, used in turn by successive frames, so that we never write to memory that the GPU might still be reading from.
+/// The ranges returned by push() are only valid until the next call to next_frame().
+/// When the driver supports GL_ARB_buffer_storage, the buffer is mapped once and for all, and push() is a simple memcpy().
+class UniformRingBuffer {
+public:
+    explicit UniformRingBuffer(size_t bytes_per_frame = 256 * 1024, size_t frames_in_flight = 3);
+    ~UniformRingBuffer();
+    UniformRingBuffer(UniformRingBuffer const&)                    = delete;
+    auto operator=(UniformRingBuffer const&) -> UniformRingBuffer& = delete;
+    UniformRingBuffer(UniformRingBuffer&&)                         = delete;
+    auto operator=(UniformRingBuffer&&) -> UniformRingBuffer&      = delete;
+
+    auto push(std::span<std::byte const> block) -> UniformBufferRange;
+    template<typename Block>
+    auto push(Block const& block) -> UniformBufferRange
+    {
+        static_assert(std::is_trivially_copyable_v<Block>, "A uniform block is copied byte by byte to the GPU.");
+        return push(std::as_bytes(std::span{&block, 1}));
+    }
+
+    /// Must be called once all the draw calls of the frame have been issued. gl::window_is_open() does it for you for the gl::uniform_ring_buffer().
+    void next_frame();
+
+private:
+    void wait_until_current_region_is_free();
+    void grow(size_t min_bytes_per_frame);
+    /// Allocates the storage of `_buffer`, and maps it persistently if the driver supports it.
+    void allocate_buffer(size_t size_in_bytes);
+
+private:
+    size_t                              _offset_alignment{};
+    size_t                              _bytes_per_frame{};
+    internal::UniqueBuffer              _buffer{};
+    std::byte*                          _mapping{nullptr};  // nullptr if the driver doesn't support persistent mapping, in which case we map the range of each push()
+    std::vector<internal::UniqueBuffer> _retired_buffers{}; // Buffers replaced by grow(), that ranges of the current frame might still refer to
+    std::vector<GLsync>                 _fences{};          // One per region, signaled when the GPU is done with the frame that last used that region
+    size_t                              _current_region{0};
+    size_t                              _offset_in_region{0};
+    bool                                _current_region_is_free{false};
+};
+
+/// A ring buffer shared by the whole app, that is advanced automatically at the end of each frame.
+auto uniform_ring_buffer() -> UniformRingBuffer&;
+
+namespace internal {
+/// Called by gl::window_is_open(), does nothing if the uniform_ring_buffer() has never been used.
+void advance_uniform_ring_buffer();
+} // namespace internal
+
+} // namespace gl
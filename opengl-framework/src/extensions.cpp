@@ -0,0 +1,37 @@
+#include "extensions.hpp"
+#include "glfw.hpp"
+
+namespace gl::internal {
+
+template<typename FunctionPointer>
+static auto load(char const* name) -> FunctionPointer
+{
+    return reinterpret_cast<FunctionPointer>(glfwGetProcAddress(name)); // NOLINT(*reinterpret-cast)
+}
+
+static auto load_extensions() -> Extensions
+{
+    auto res = Extensions{};
+
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+        res.glMaxShaderCompilerThreadsKHR = load<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>("glMaxShaderCompilerThreadsKHR");
+    else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+        res.glMaxShaderCompilerThreadsKHR = load<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>("glMaxShaderCompilerThreadsARB");
+    res.parallel_shader_compile = res.glMaxShaderCompilerThreadsKHR != nullptr;
+    if (res.parallel_shader_compile)
+        res.glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); // Let the driver use as many threads as it wants
+
+    if (glfwExtensionSupported("GL_ARB_buffer_storage"))
+        res.glBufferStorage = load<PFNGLBUFFERSTORAGEPROC>("glBufferStorage");
+    res.buffer_storage = res.glBufferStorage != nullptr;
+
+    return res;
+}
+
+auto extensions() -> Extensions const&
+{
+    static auto const instance = load_extensions();
+    return instance;
+}
+
+} // namespace gl::internal
@@ -0,0 +1,34 @@
+#pragma once
+#include "glad/gl.h"
+
+// glad only loads the core functions of OpenGL 4.3, so the extensions we use are loaded by hand here.
+
+// GL_KHR_parallel_shader_compile (also exposed as GL_ARB_parallel_shader_compile, with the same values)
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR           0x91B1
+
+// GL_ARB_buffer_storage (core since OpenGL 4.4)
+#define GL_MAP_PERSISTENT_BIT  0x0040
+#define GL_MAP_COHERENT_BIT    0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT  0x0200
+
+namespace gl::internal {
+
+using PFNGLMAXSHADERCOMPILERTHREADSKHRPROC = void(GLAD_API_PTR*)(GLuint count);
+using PFNGLBUFFERSTORAGEPROC               = void(GLAD_API_PTR*)(GLenum target, GLsizeiptr size, void const* data, GLbitfield flags);
+
+struct Extensions {
+    /// When true, compiling and linking happen on driver threads, and we can poll GL_COMPLETION_STATUS_KHR to know if they are done without blocking.
+    bool                                 parallel_shader_compile{false};
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR{nullptr};
+
+    /// When true, buffers can be mapped once and written to while the GPU uses them (GL_MAP_PERSISTENT_BIT).
+    bool                   buffer_storage{false};
+    PFNGLBUFFERSTORAGEPROC glBufferStorage{nullptr};
+};
+
+/// Loads the extensions the first time it is called, so it must only be called once the OpenGL context has been created.
+auto extensions() -> Extensions const&;
+
+} // namespace gl::internal
@@ -0,0 +1,233 @@
+#include "load_mesh.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include "Hasher.hpp"
+#include "MeshCache.hpp"
+#include "handle_error.hpp"
+#include "make_absolute_path.hpp"
+#include "tinyobj_loader_opt.h"
+
+namespace gl {
+
+namespace {
+
+constexpr int position_location = 0;
+constexpr int uv_location       = 1;
+constexpr int normal_location   = 2;
+
+auto read_file(std::filesystem::path const& path) -> std::vector<char>
+{
+    auto file = std::ifstream{path, std::ios::binary | std::ios::ate};
+    if (!file)
+        handle_error(std::format("Failed to open \"{}\".", path.string()));
+    auto content = std::vector<char>(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(content.data(), static_cast<std::streamsize>(content.size()));
+    return content;
+}
+
+/// Finds the vertices that use the same position, UV and normal, so that we only store them once.
+/// This is an open addressing hash table, so it allocates all its memory once, instead of once per vertex like std::unordered_map.
+class VertexDeduplicator {
+public:
+    explicit VertexDeduplicator(size_t max_vertices_count)
+        : _slots(std::bit_ceil(2 * std::max<size_t>(max_vertices_count, 1)), empty_slot)
+    {
+        _keys.reserve(max_vertices_count);
+    }
+
+    /// Returns the index of the vertex, and whether it is a new one.
+    auto insert(tinyobj_opt::index_t const& key) -> std::pair<uint32_t, bool>
+    {
+        size_t const mask = _slots.size() - 1;
+        for (size_t slot = hash(key) & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t const vertex = _slots[slot];
+            if (vertex == empty_slot)
+            {
+                _slots[slot] = static_cast<uint32_t>(_keys.size());
+                _keys.push_back(key);
+                return {_slots[slot], true};
+            }
+            auto const& other = _keys[vertex];
+            if (other.vertex_index == key.vertex_index && other.texcoord_index == key.texcoord_index && other.normal_index == key.normal_index)
+                return {vertex, false};
+        }
+    }
+
+private:
+    static auto hash(tinyobj_opt::index_t const& key) -> size_t
+    {
+        auto h = static_cast<uint64_t>(static_cast<uint32_t>(key.vertex_index));
+        h      = h * 0x9E3779B97F4A7C15 ^ static_cast<uint32_t>(key.texcoord_index);
+        h      = h * 0x9E3779B97F4A7C15 ^ static_cast<uint32_t>(key.normal_index);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+private:
+    static constexpr uint32_t empty_slot = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t>             _slots;
+    std::vector<tinyobj_opt::index_t> _keys{}; // Indexed by vertex
+};
+
+auto parse_obj(std::filesystem::path const& absolute_path) -> MeshData
+{
+    auto const file = read_file(absolute_path);
+
+    auto attrib    = tinyobj_opt::attrib_t{};
+    auto shapes    = std::vector<tinyobj_opt::shape_t>{};
+    auto materials = std::vector<tinyobj_opt::material_t>{};
+    auto options   = tinyobj_opt::LoadOption{};
+
+    options.req_num_threads = -1; // As many as the machine has
+    options.triangulate     = true;
+    if (!tinyobj_opt::parseObj(&attrib, &shapes, &materials, file.data(), file.size(), options))
+        handle_error(std::format("Failed to parse \"{}\".", absolute_path.string()));
+
+    auto const positions_count = attrib.vertices.size() / 3;
+    auto const uvs_count       = attrib.texcoords.size() / 2;
+    auto const normals_count   = attrib.normals.size() / 3;
+    bool const has_uvs         = uvs_count != 0;
+    bool const has_normals     = normals_count != 0;
+
+    auto res = MeshData{};
+    res.layout.emplace_back(VertexAttribute::Position3D{position_location});
+    if (has_uvs)
+        res.layout.emplace_back(VertexAttribute::UV{uv_location});
+    if (has_normals)
+        res.layout.emplace_back(VertexAttribute::Normal3D{normal_location});
+    size_t const floats_per_vertex = size_t{3} + (has_uvs ? 2u : 0u) + (has_normals ? 3u : 0u);
+
+    // Most files share each position between several faces, with the same UV and normal, so the number of positions is a good guess for the number of vertices
+    res.vertices.reserve(positions_count * floats_per_vertex);
+    res.indices.reserve(attrib.indices.size());
+    auto deduplicator = VertexDeduplicator{attrib.indices.size()};
+
+    auto const is_valid = [](int index, size_t count) { return index >= 0 && static_cast<size_t>(index) < count; };
+    auto const copy     = [&](auto const& source, int index, size_t components_count) {
+        if (is_valid(index, source.size() / components_count))
+        {
+            auto const first = source.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(index) * components_count);
+            res.vertices.insert(res.vertices.end(), first, first + static_cast<std::ptrdiff_t>(components_count));
+        }
+        else
+            res.vertices.insert(res.vertices.end(), components_count, 0.f); // This face doesn't have a UV / normal, even though others do
+    };
+
+    size_t face_start = 0;
+    for (int const face_size : attrib.face_num_verts)
+    {
+        auto const face_end = face_start + static_cast<size_t>(face_size);
+        if (face_size != 3) // Points and lines, we only care about triangles
+        {
+            face_start = face_end;
+            continue;
+        }
+        for (size_t i = face_start; i < face_end; ++i)
+        {
+            auto const& key = attrib.indices[i];
+            if (!is_valid(key.vertex_index, positions_count))
+                handle_error(std::format("Failed to load \"{}\": a face uses vertex {}, but there are only {} vertices.", absolute_path.string(), key.vertex_index + 1, positions_count));
+
+            auto const [vertex, is_new] = deduplicator.insert(key);
+            res.indices.push_back(vertex);
+            if (!is_new)
+                continue;
+            copy(attrib.vertices, key.vertex_index, 3);
+            if (has_uvs)
+                copy(attrib.texcoords, key.texcoord_index, 2);
+            if (has_normals)
+                copy(attrib.normals, key.normal_index, 3);
+        }
+        face_start = face_end;
+    }
+    return res;
+}
+
+auto import_mesh(std::filesystem::path const& absolute_path, MeshImport_Options const& options) -> MeshData
+{
+    auto res = parse_obj(absolute_path);
+    if (options.optimize)
+    {
+        auto const report = optimize_mesh(res, options.optimization);
+        if (options.log_statistics)
+        {
+            std::cout << std::format(
+                "[Mesh optimization] \"{}\": ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n",
+                absolute_path.string(), report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr
+            );
+        }
+    }
+    return res;
+}
+
+/// The layout of the imported mesh, with the compact formats enabled in `options`.
+auto quantized_layout(std::vector<AnyVertexAttribute> layout, VertexQuantization_Options const& options) -> std::vector<AnyVertexAttribute>
+{
+    for (auto& attribute : layout)
+    {
+        int const location = std::visit([](auto&& attribute) { return attribute.index(); }, attribute);
+        if (location == position_location && options.positions)
+            attribute = VertexAttribute::HalfPosition3D{location};
+        else if (location == uv_location && options.uvs)
+            attribute = VertexAttribute::HalfUV{location};
+        else if (location == normal_location && options.normals)
+            attribute = VertexAttribute::PackedNormal3D{location};
+    }
+    return layout;
+}
+
+/// The options change the result of the import, so they are part of the key.
+auto cache_key(std::filesystem::path const& absolute_path, MeshImport_Options const& options, VertexQuantization_Options const& quantization) -> uint64_t
+{
+    auto hasher = internal::Hasher{};
+    hasher.add(internal::mesh_cache_key(absolute_path));
+    hasher.add(uint64_t{options.optimize});
+    hasher.add(uint64_t{options.optimization.optimize_overdraw});
+    hasher.add(uint64_t{std::bit_cast<uint32_t>(options.optimization.overdraw_threshold)});
+    hasher.add(uint64_t{quantization.positions});
+    hasher.add(uint64_t{quantization.normals});
+    hasher.add(uint64_t{quantization.uvs});
+    return hasher.hash();
+}
+
+} // namespace
+
+auto load_mesh_data(std::filesystem::path const& path, MeshImport_Options const& options) -> MeshData
+{
+    auto const absolute_path = make_absolute_path(path);
+    auto const key           = cache_key(absolute_path, options, VertexQuantization_Options{.positions = false, .normals = false, .uvs = false});
+    if (auto const cached = internal::load_cached_mesh(key))
+    {
+        auto res = MeshData{.layout = cached->layout, .vertices = std::vector<float>(cached->vertices.size() / sizeof(float)), .indices = internal::indices_as_uint32(*cached)};
+        std::memcpy(res.vertices.data(), cached->vertices.data(), res.vertices.size() * sizeof(float));
+        return res;
+    }
+    auto res = import_mesh(absolute_path, options);
+    internal::save_cached_mesh(key, res.layout, std::as_bytes(std::span{res.vertices}), res.indices);
+    return res;
+}
+
+auto load_mesh(std::filesystem::path const& path, MeshImport_Options const& options) -> Mesh
+{
+    auto const absolute_path = make_absolute_path(path);
+    auto const key           = cache_key(absolute_path, options, options.quantization);
+    if (auto const cached = internal::load_cached_mesh(key))
+    {
+        // Straight from the memory-mapped file to the GPU
+        auto const vertex_buffers = std::vector{VertexBuffer_Descriptor{.layout = cached->layout, .bytes = cached->vertices}};
+        return Mesh{Mesh_Descriptor{.vertex_buffers = vertex_buffers, .index_buffer_bytes = cached->indices, .index_type = cached->index_type}};
+    }
+    auto       mesh = import_mesh(absolute_path, options);
+    auto const data = quantize_mesh(mesh, quantized_layout(mesh.layout, options.quantization));
+    internal::save_cached_mesh(key, data.layout, data.vertices, data.indices);
+    return make_mesh(data);
+}
+
+} // namespace gl
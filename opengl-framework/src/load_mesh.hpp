@@ -0,0 +1,41 @@
+#pragma once
+#include <filesystem>
+#include "Mesh.hpp"
+#include "MeshData.hpp"
+#include "optimize_mesh.hpp"
+#include "quantize_mesh.hpp"
+
+namespace gl {
+
+/// Which attributes load_mesh() stores in compact formats on the GPU (see quantize_mesh()). With the defaults, a vertex with a position, a UV and a normal takes 20 bytes instead of 32, and 16 if you also enable `positions`.
+struct VertexQuantization_Options {
+    /// Half floats (VertexAttribute::HalfPosition3D): 8 bytes instead of 12.
+    /// Off by default because half floats only have about 3 significant digits: enough for a small object centered on the origin, but not for a big scene or an object far from the origin.
+    bool positions{false};
+    /// 10 bits per component (VertexAttribute::PackedNormal3D): 4 bytes instead of 12.
+    bool normals{true};
+    /// Half floats (VertexAttribute::HalfUV): 4 bytes instead of 8. Precise to half a texel on a 1024x1024 texture, even if the UVs go a bit outside of [0, 1].
+    bool uvs{true};
+};
+
+struct MeshImport_Options {
+    /// Reorders the triangles and vertices so that the mesh is faster to draw, see optimize_mesh().
+    bool                     optimize{true};
+    MeshOptimization_Options optimization{};
+    /// Prints the vertex cache statistics before and after the optimization. Nothing is printed when the mesh comes from the cache, since it is already optimized.
+    bool log_statistics{false};
+    /// Only used by load_mesh(): load_mesh_data() always returns floats, which are easier to work with on the CPU.
+    VertexQuantization_Options quantization{};
+};
+
+/// Loads a .obj file. Relative paths are relative to the folder of the executable (see make_absolute_path()).
+/// The attributes are the position at location 0 (vec3), the UV at location 1 (vec2) and the normal at location 2 (vec3). UVs and normals are only in the layout if the file contains some.
+/// Faces are triangulated, and identical vertices are only stored once.
+/// The file is parsed on all the cores of the machine, which makes a huge difference for big files.
+/// The result is cached on disk (see MeshCache.hpp), so only the first load of each version of a file pays for the parsing and the optimization.
+auto load_mesh_data(std::filesystem::path const& path, MeshImport_Options const& = {}) -> MeshData;
+
+/// Loads a .obj file, see load_mesh_data() for the details.
+auto load_mesh(std::filesystem::path const& path, MeshImport_Options const& = {}) -> Mesh;
+
+} // namespace gl
@@ -2,6 +2,7 @@
 #include <glad/gl.h>
 #include <cassert>
 #include <format>
+#include <functional>
 #include <iostream>
 #include <vector>
 #include "Camera.hpp"
@@ -13,11 +14,12 @@
 
 namespace {
 struct Context { // NOLINT(*special-member-functions)
-    GLFWwindow*                      window{nullptr};
-    std::vector<gl::EventsCallbacks> events_callbacks{};
-    float                            last_time{0.f};
-    float                            delta_time{0.f};
-    bool                             is_first_frame{true};
+    GLFWwindow*                        window{nullptr};
+    std::vector<gl::EventsCallbacks>   events_callbacks{};
+    std::vector<std::function<void()>> end_of_frame_callbacks{};
+    float                              last_time{0.f};
+    float                              delta_time{0.f};
+    bool                               is_first_frame{true};
 
     ~Context()
     {
@@ -130,7 +132,7 @@ void scroll_callback(GLFWwindow*, double x_offset, double y_offset)
 }
 void framebuffer_resized_callback(GLFWwindow*, int width_in_pixels, int height_in_pixels)
 {
-    glViewport(0, 0, width_in_pixels, height_in_pixels);
+    gl::state_cache().set_viewport({0, 0, width_in_pixels, height_in_pixels});
     for (auto const& callbacks : context().events_callbacks)
         callbacks.on_framebuffer_resized({.width_in_pixels = width_in_pixels, .height_in_pixels = height_in_pixels});
 }
@@ -213,12 +215,21 @@ auto window_is_open() -> bool
         context().delta_time = time - context().last_time;
     context().last_time = time;
 
+    for (auto const& callback : context().end_of_frame_callbacks)
+        callback();
+    internal::advance_uniform_ring_buffer();
     glfwSwapBuffers(context().window);
     glfwPollEvents();
+    internal::reload_changed_shaders();
     context().is_first_frame = false;
     return !glfwWindowShouldClose(context().window);
 }
 
+void add_end_of_frame_callback(std::function<void()> callback)
+{
+    context().end_of_frame_callbacks.push_back(std::move(callback));
+}
+
 auto framebuffer_width_in_pixels() -> int
 {
     int w; // NOLINT(*init-variables)
@@ -0,0 +1,406 @@
+#include "optimize_mesh.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace gl {
+
+namespace {
+
+constexpr uint32_t no_vertex   = std::numeric_limits<uint32_t>::max();
+constexpr size_t   no_triangle = std::numeric_limits<size_t>::max();
+
+/// Simulates a FIFO post-transform cache, which is what most GPUs have (or at least what they behave the closest to).
+class FifoCacheSimulator {
+public:
+    FifoCacheSimulator(size_t vertices_count, size_t cache_size)
+        : _insertion_time(vertices_count, 0)
+        , _cache_size{cache_size}
+        , _time{cache_size + 1}
+    {}
+
+    /// Returns true iff the vertex had to be transformed.
+    auto transform(uint32_t index) -> bool
+    {
+        if (_time - _insertion_time[index] <= _cache_size)
+            return false;
+        _insertion_time[index] = _time++;
+        return true;
+    }
+
+    /// Forgets everything, as if we were starting to draw another mesh.
+    void flush() { _time += _cache_size + 1; }
+
+private:
+    std::vector<size_t> _insertion_time;
+    size_t              _cache_size;
+    size_t              _time;
+};
+
+// Constants from Tom Forsyth's article
+constexpr size_t forsyth_cache_size          = 32;
+constexpr size_t forsyth_valence_table_size  = 32;
+constexpr float  forsyth_cache_decay_power   = 1.5f;
+constexpr float  forsyth_last_triangle_score = 0.75f;
+constexpr float  forsyth_valence_boost_scale = 2.f;
+constexpr float  forsyth_valence_boost_power = 0.5f;
+
+struct ForsythScoreTables {
+    std::array<float, forsyth_cache_size>         cache{};
+    std::array<float, forsyth_valence_table_size> valence{};
+};
+
+auto forsyth_score_tables() -> ForsythScoreTables const&
+{
+    static auto const instance = []() {
+        auto res = ForsythScoreTables{};
+        for (size_t position = 0; position < forsyth_cache_size; ++position)
+        {
+            // The 3 vertices of the last triangle get a fixed score, so that we don't favour using the same 2 vertices over and over (which would give long strips)
+            res.cache[position] = position < 3
+                                      ? forsyth_last_triangle_score
+                                      : std::pow(1.f - static_cast<float>(position - 3) / static_cast<float>(forsyth_cache_size - 3), forsyth_cache_decay_power);
+        }
+        for (size_t valence = 1; valence < forsyth_valence_table_size; ++valence)
+            res.valence[valence] = forsyth_valence_boost_scale * std::pow(static_cast<float>(valence), -forsyth_valence_boost_power);
+        return res;
+    }();
+    return instance;
+}
+
+/// `cache_position` is -1 if the vertex is not in the cache.
+auto forsyth_vertex_score(int cache_position, uint32_t remaining_valence) -> float
+{
+    if (remaining_valence == 0)
+        return -1.f; // No triangle needs this vertex anymore
+    auto const& tables = forsyth_score_tables();
+    float const cache_score = cache_position >= 0 ? tables.cache[static_cast<size_t>(cache_position)] : 0.f;
+    // Favour the vertices that are used by few remaining triangles, so that we finish them off instead of leaving isolated triangles behind, that would cost a lot of cache misses later
+    float const valence_score = remaining_valence < forsyth_valence_table_size
+                                    ? tables.valence[remaining_valence]
+                                    : forsyth_valence_boost_scale * std::pow(static_cast<float>(remaining_valence), -forsyth_valence_boost_power);
+    return cache_score + valence_score;
+}
+
+} // namespace
+
+auto vertex_cache_statistics(std::span<uint32_t const> indices, size_t vertices_count, size_t cache_size) -> VertexCacheStatistics
+{
+    if (indices.size() < 3 || vertices_count == 0)
+        return {};
+    auto   cache  = FifoCacheSimulator{vertices_count, cache_size};
+    size_t misses = 0;
+    for (uint32_t const index : indices)
+    {
+        if (cache.transform(index))
+            misses++;
+    }
+    return {
+        .acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3),
+        .atvr = static_cast<float>(misses) / static_cast<float>(vertices_count),
+    };
+}
+
+auto optimize_mesh(MeshData& mesh, MeshOptimization_Options const& options) -> MeshOptimizationReport
+{
+    auto report   = MeshOptimizationReport{};
+    report.before = vertex_cache_statistics(mesh.indices, mesh.vertices_count());
+    if (mesh.indices.empty())
+        return report;
+
+    deduplicate_vertices(mesh);
+    optimize_vertex_cache(mesh.indices, mesh.vertices_count());
+    if (options.optimize_overdraw)
+        optimize_overdraw(mesh, options.overdraw_threshold);
+    optimize_vertex_fetch(mesh);
+
+    report.after = vertex_cache_statistics(mesh.indices, mesh.vertices_count());
+    return report;
+}
+
+void deduplicate_vertices(MeshData& mesh)
+{
+    size_t const stride         = mesh.floats_per_vertex();
+    size_t const vertices_count = mesh.vertices_count();
+    if (vertices_count == 0 || mesh.indices.empty())
+        return;
+
+    auto const vertex = [&](size_t index) { return mesh.vertices.data() + index * stride; }; // NOLINT(*pointer-arithmetic)
+    auto const hash   = [&](size_t index) {
+        uint64_t h = 0xCBF29CE484222325;
+        for (size_t i = 0; i < stride; ++i)
+            h = (h ^ std::bit_cast<uint32_t>(vertex(index)[i])) * 0x100000001B3; // NOLINT(*pointer-arithmetic)
+        return static_cast<size_t>(h ^ (h >> 29));
+    };
+
+    // Open addressing hash table of the unique vertices, which we compact at the beginning of the vertices as we find them
+    auto         slots        = std::vector<uint32_t>(std::bit_ceil(2 * vertices_count), no_vertex);
+    size_t const mask         = slots.size() - 1;
+    auto         remap        = std::vector<uint32_t>(vertices_count);
+    uint32_t     unique_count = 0;
+    size_t const vertex_bytes = stride * sizeof(float);
+    for (size_t index = 0; index < vertices_count; ++index)
+    {
+        size_t slot = hash(index) & mask;
+        while (slots[slot] != no_vertex && std::memcmp(vertex(slots[slot]), vertex(index), vertex_bytes) != 0)
+            slot = (slot + 1) & mask;
+        if (slots[slot] == no_vertex)
+        {
+            slots[slot] = unique_count;
+            if (unique_count != index)
+                std::memcpy(vertex(unique_count), vertex(index), vertex_bytes);
+            unique_count++;
+        }
+        remap[index] = slots[slot];
+    }
+
+    mesh.vertices.resize(unique_count * stride);
+    for (uint32_t& index : mesh.indices)
+        index = remap[index];
+}
+
+void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertices_count)
+{
+    size_t const triangles_count = indices.size() / 3;
+    if (triangles_count == 0)
+        return;
+
+    // The triangles that use each vertex. Each list only contains the triangles that have not been emitted yet, so its size is the remaining valence of the vertex.
+    auto valence = std::vector<uint32_t>(vertices_count, 0);
+    for (uint32_t const index : indices)
+        valence[index]++;
+    auto first_adjacent_triangle = std::vector<size_t>(vertices_count);
+    std::exclusive_scan(valence.begin(), valence.end(), first_adjacent_triangle.begin(), size_t{0});
+    auto adjacent_triangles = std::vector<size_t>(indices.size());
+    {
+        auto next = first_adjacent_triangle;
+        for (size_t triangle = 0; triangle < triangles_count; ++triangle)
+        {
+            for (size_t corner = 0; corner < 3; ++corner)
+                adjacent_triangles[next[indices[3 * triangle + corner]]++] = triangle;
+        }
+    }
+    auto const remaining_triangles = [&](uint32_t vertex) {
+        return std::span{adjacent_triangles}.subspan(first_adjacent_triangle[vertex], valence[vertex]);
+    };
+
+    auto vertex_score = std::vector<float>(vertices_count);
+    for (size_t vertex = 0; vertex < vertices_count; ++vertex)
+        vertex_score[vertex] = forsyth_vertex_score(-1, valence[vertex]);
+    auto triangle_score = std::vector<float>(triangles_count);
+    for (size_t triangle = 0; triangle < triangles_count; ++triangle)
+        triangle_score[triangle] = vertex_score[indices[3 * triangle]] + vertex_score[indices[3 * triangle + 1]] + vertex_score[indices[3 * triangle + 2]];
+    auto is_emitted = std::vector<uint8_t>(triangles_count, 0);
+
+    auto result = std::vector<uint32_t>{};
+    result.reserve(indices.size());
+    auto   cache          = std::array<uint32_t, forsyth_cache_size + 3>{}; // +3 for the vertices that get pushed out of the cache by the triangle we emit
+    size_t cache_count    = 0;
+    size_t best_triangle  = static_cast<size_t>(std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin());
+    size_t input_position = 0;
+
+    for (size_t emitted_count = 0; emitted_count < triangles_count; ++emitted_count)
+    {
+        if (best_triangle == no_triangle)
+        {
+            // Nothing in the cache leads to a remaining triangle, so we start again somewhere else in the mesh. Any triangle works.
+            while (is_emitted[input_position])
+                input_position++;
+            best_triangle = input_position;
+        }
+
+        auto const triangle = std::array{indices[3 * best_triangle], indices[3 * best_triangle + 1], indices[3 * best_triangle + 2]};
+        result.insert(result.end(), triangle.begin(), triangle.end());
+        is_emitted[best_triangle] = 1;
+        for (uint32_t const vertex : triangle)
+        {
+            auto triangles = remaining_triangles(vertex);
+            auto it        = std::find(triangles.begin(), triangles.end(), best_triangle);
+            if (it == triangles.end()) // Degenerate triangle that uses the same vertex twice, and we already removed it
+                continue;
+            std::iter_swap(it, triangles.end() - 1);
+            valence[vertex]--;
+        }
+
+        // The vertices of the triangle move to the front of the cache (it is an LRU cache in Forsyth's model), and push the other ones back
+        auto   new_cache       = std::array<uint32_t, forsyth_cache_size + 3>{};
+        size_t new_cache_count = 0;
+        for (uint32_t const vertex : triangle)
+        {
+            if (std::find(new_cache.begin(), new_cache.begin() + static_cast<std::ptrdiff_t>(new_cache_count), vertex) == new_cache.begin() + static_cast<std::ptrdiff_t>(new_cache_count))
+                new_cache[new_cache_count++] = vertex;
+        }
+        for (size_t i = 0; i < cache_count; ++i)
+        {
+            if (std::find(triangle.begin(), triangle.end(), cache[i]) == triangle.end())
+                new_cache[new_cache_count++] = cache[i];
+        }
+
+        // Only the scores of the vertices that moved in the cache (or out of it) have changed
+        for (size_t i = 0; i < new_cache_count; ++i)
+        {
+            uint32_t const vertex   = new_cache[i];
+            int const      position = i < forsyth_cache_size ? static_cast<int>(i) : -1;
+            float const    score    = forsyth_vertex_score(position, valence[vertex]);
+            float const    delta    = score - vertex_score[vertex];
+            vertex_score[vertex]    = score;
+            for (size_t const adjacent_triangle : remaining_triangles(vertex))
+                triangle_score[adjacent_triangle] += delta;
+        }
+
+        cache       = new_cache;
+        cache_count = std::min(new_cache_count, forsyth_cache_size);
+
+        // The best next triangle is almost always one that uses a vertex in the cache, so we only look at those
+        best_triangle    = no_triangle;
+        float best_score = std::numeric_limits<float>::lowest();
+        for (size_t i = 0; i < cache_count; ++i)
+        {
+            for (size_t const adjacent_triangle : remaining_triangles(cache[i]))
+            {
+                if (triangle_score[adjacent_triangle] > best_score)
+                {
+                    best_triangle = adjacent_triangle;
+                    best_score    = triangle_score[adjacent_triangle];
+                }
+            }
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void optimize_overdraw(MeshData& mesh, float threshold)
+{
+    auto const offset = mesh.position_offset();
+    assert(offset.has_value() && "optimize_overdraw() requires a 3D position at location 0.");
+    size_t const triangles_count = mesh.indices.size() / 3;
+    if (!offset.has_value() || triangles_count == 0)
+        return;
+
+    size_t const stride   = mesh.floats_per_vertex();
+    auto const   position = [&](uint32_t index) { return glm::make_vec3(mesh.vertices.data() + index * stride + *offset); }; // NOLINT(*pointer-arithmetic)
+
+    // Split the triangles into clusters, that we can then reorder freely.
+    // Hard boundaries: where the cache is effectively flushed already (all the vertices of the triangle are cache misses), so reordering costs nothing.
+    constexpr size_t cache_size = 16;
+    auto             cache      = FifoCacheSimulator{mesh.vertices_count(), cache_size};
+    auto             misses     = std::vector<uint8_t>(triangles_count);
+    auto             hard_start = std::vector<size_t>{};
+    for (size_t triangle = 0; triangle < triangles_count; ++triangle)
+    {
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            if (cache.transform(mesh.indices[3 * triangle + corner]))
+                misses[triangle]++;
+        }
+        if (triangle == 0 || misses[triangle] == 3)
+            hard_start.push_back(triangle);
+    }
+    hard_start.push_back(triangles_count);
+
+    // Soft boundaries: inside each hard cluster, we cut as soon as the part we have so far has an ACMR (starting from an empty cache) that is close enough to the one of the whole hard cluster
+    auto cluster_start = std::vector<size_t>{};
+    for (size_t hard = 0; hard + 1 < hard_start.size(); ++hard)
+    {
+        size_t const begin        = hard_start[hard];
+        size_t const end          = hard_start[hard + 1];
+        float const  cluster_acmr = static_cast<float>(std::accumulate(misses.begin() + static_cast<std::ptrdiff_t>(begin), misses.begin() + static_cast<std::ptrdiff_t>(end), size_t{0}))
+                                   / static_cast<float>(end - begin);
+        cache.flush();
+        cluster_start.push_back(begin);
+        size_t soft_misses = 0;
+        for (size_t triangle = begin; triangle < end; ++triangle)
+        {
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                if (cache.transform(mesh.indices[3 * triangle + corner]))
+                    soft_misses++;
+            }
+            float const soft_acmr = static_cast<float>(soft_misses) / static_cast<float>(triangle - cluster_start.back() + 1);
+            if (soft_acmr <= cluster_acmr * threshold && triangle + 1 < end)
+            {
+                cache.flush();
+                cluster_start.push_back(triangle + 1);
+                soft_misses = 0;
+            }
+        }
+    }
+    cluster_start.push_back(triangles_count);
+    size_t const clusters_count = cluster_start.size() - 1;
+
+    // Draw first the clusters that face outwards: they are the most likely to hide the other ones
+    auto mesh_centroid = glm::vec3{0.f};
+    auto mesh_area     = 0.f;
+    auto centroids     = std::vector<glm::vec3>(clusters_count, glm::vec3{0.f});
+    auto normals       = std::vector<glm::vec3>(clusters_count, glm::vec3{0.f});
+    for (size_t cluster = 0; cluster < clusters_count; ++cluster)
+    {
+        float cluster_area = 0.f;
+        for (size_t triangle = cluster_start[cluster]; triangle < cluster_start[cluster + 1]; ++triangle)
+        {
+            auto const  a      = position(mesh.indices[3 * triangle]);
+            auto const  b      = position(mesh.indices[3 * triangle + 1]);
+            auto const  c      = position(mesh.indices[3 * triangle + 2]);
+            auto const  normal = glm::cross(b - a, c - a); // Its length is twice the area of the triangle
+            float const area   = glm::length(normal);
+            centroids[cluster] += (a + b + c) / 3.f * area;
+            normals[cluster] += normal;
+            cluster_area += area;
+        }
+        mesh_centroid += centroids[cluster];
+        mesh_area += cluster_area;
+        centroids[cluster] = cluster_area > 0.f ? centroids[cluster] / cluster_area : position(mesh.indices[3 * cluster_start[cluster]]);
+    }
+    if (mesh_area > 0.f)
+        mesh_centroid /= mesh_area;
+
+    auto sort_key = std::vector<float>(clusters_count);
+    for (size_t cluster = 0; cluster < clusters_count; ++cluster)
+    {
+        float const normal_length = glm::length(normals[cluster]);
+        sort_key[cluster]         = normal_length > 0.f ? glm::dot(centroids[cluster] - mesh_centroid, normals[cluster] / normal_length) : 0.f;
+    }
+    auto order = std::vector<size_t>(clusters_count);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sort_key[a] > sort_key[b]; });
+
+    auto result = std::vector<uint32_t>{};
+    result.reserve(mesh.indices.size());
+    for (size_t const cluster : order)
+        result.insert(result.end(), mesh.indices.begin() + static_cast<std::ptrdiff_t>(3 * cluster_start[cluster]), mesh.indices.begin() + static_cast<std::ptrdiff_t>(3 * cluster_start[cluster + 1]));
+    mesh.indices = std::move(result);
+}
+
+void optimize_vertex_fetch(MeshData& mesh)
+{
+    if (mesh.indices.empty())
+        return;
+
+    size_t const stride   = mesh.floats_per_vertex();
+    auto         remap    = std::vector<uint32_t>(mesh.vertices_count(), no_vertex);
+    auto         vertices = std::vector<float>{};
+    vertices.reserve(mesh.vertices.size());
+    uint32_t next_vertex = 0;
+    for (uint32_t& index : mesh.indices)
+    {
+        if (remap[index] == no_vertex)
+        {
+            remap[index] = next_vertex++;
+            auto const first = mesh.vertices.begin() + static_cast<std::ptrdiff_t>(index * stride);
+            vertices.insert(vertices.end(), first, first + static_cast<std::ptrdiff_t>(stride));
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+} // namespace gl
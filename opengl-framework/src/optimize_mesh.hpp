@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "MeshData.hpp"
+
+namespace gl {
+
+/// How well the order of the indices uses the post-transform vertex cache of the GPU, simulated as a FIFO cache of `cache_size` vertices.
+struct VertexCacheStatistics {
+    float acmr{}; // Average Cache Miss Ratio: vertex shader invocations per triangle. 3 is the worst, and around 0.6 is as good as it gets for big regular meshes.
+    float atvr{}; // Average Transformed Vertex Ratio: vertex shader invocations per vertex. 1 is optimal.
+};
+auto vertex_cache_statistics(std::span<uint32_t const> indices, size_t vertices_count, size_t cache_size = 16) -> VertexCacheStatistics;
+
+struct MeshOptimization_Options {
+    /// Reorders groups of triangles so that the ones facing outwards are drawn first, which reduces overdraw when the mesh is drawn with depth testing.
+    /// This costs a bit of vertex cache efficiency (see `overdraw_threshold`). Requires a 3D position at location 0.
+    bool optimize_overdraw{false};
+    /// How much worse the ACMR is allowed to get when optimizing overdraw. 1.05 means 5% worse.
+    float overdraw_threshold{1.05f};
+};
+
+struct MeshOptimizationReport {
+    VertexCacheStatistics before{};
+    VertexCacheStatistics after{};
+};
+
+/// Runs all the passes below, in the right order. The mesh is drawn exactly the same, just faster.
+auto optimize_mesh(MeshData&, MeshOptimization_Options const& = {}) -> MeshOptimizationReport;
+
+/// Merges the vertices whose attributes are all bit-for-bit identical.
+void deduplicate_vertices(MeshData&);
+/// Reorders the triangles so that they reuse the vertices that have just been transformed as much as possible (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation").
+void optimize_vertex_cache(std::span<uint32_t> indices, size_t vertices_count);
+/// Must be called after optimize_vertex_cache(), because it relies on the triangles being in cache-friendly order (Sander, Nehab and Barczak's "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+void optimize_overdraw(MeshData&, float threshold);
+/// Reorders the vertices in the order in which the triangles use them, so that fetching them is cache-friendly too. Also removes the vertices that are not used by any triangle.
+/// Must be called last, because it depends on the order of the triangles.
+void optimize_vertex_fetch(MeshData&);
+
+} // namespace gl
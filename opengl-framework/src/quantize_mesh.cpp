@@ -0,0 +1,170 @@
+#include "quantize_mesh.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+namespace gl {
+
+namespace internal {
+
+auto float_to_half(float value) -> uint16_t
+{
+    // Based on Fabian Giesen's float_to_half_fast3_rtne()
+    auto const bits     = std::bit_cast<uint32_t>(value);
+    auto const sign     = (bits >> 16) & 0x8000u;
+    auto const abs_bits = bits & 0x7FFFFFFFu;
+
+    if (abs_bits >= 0x47800000u) // Too big for a half (65536 and more), infinity or NaN
+        return static_cast<uint16_t>(sign | (abs_bits > 0x7F800000u ? 0x7E00u : 0x7C00u));
+    if (abs_bits < 0x38800000u) // Becomes a subnormal half (or 0)
+    {
+        // Adding 0.5 shifts the mantissa so that the FPU rounds it exactly like a half subnormal
+        auto const shifted = std::bit_cast<float>(abs_bits) + 0.5f;
+        return static_cast<uint16_t>(sign | (std::bit_cast<uint32_t>(shifted) - 0x3F000000u));
+    }
+    // Changes the exponent bias from 127 to 15, and rounds the mantissa to nearest even. If the mantissa overflows, the carry goes into the exponent, which is what we want.
+    auto const mantissa_is_odd = (abs_bits >> 13) & 1u;
+    return static_cast<uint16_t>(sign | ((abs_bits + 0xC8000FFFu + mantissa_is_odd) >> 13));
+}
+
+auto half_to_float(uint16_t value) -> float
+{
+    // Based on Fabian Giesen's half_to_float_fast5()
+    constexpr auto exponent_offset = std::bit_cast<float>(uint32_t{(254 - 15) << 23}); // Multiplying by it changes the exponent bias from 15 to 127, and normalizes the subnormals
+    constexpr auto was_inf_or_nan  = std::bit_cast<float>(uint32_t{(127 + 16) << 23});
+
+    auto const res  = std::bit_cast<float>((uint32_t{value} & 0x7FFFu) << 13) * exponent_offset;
+    auto       bits = std::bit_cast<uint32_t>(res);
+    if (res >= was_inf_or_nan)
+        bits |= 255u << 23;
+    return std::bit_cast<float>(bits | ((uint32_t{value} & 0x8000u) << 16));
+}
+
+} // namespace internal
+
+namespace {
+
+auto locations_count(AnyVertexAttribute const& attribute) -> GLint
+{
+    return std::visit([](auto&& attribute) { return attribute.locations_count(); }, attribute);
+}
+auto attribute_size_in_bytes(AnyVertexAttribute const& attribute) -> size_t
+{
+    return static_cast<size_t>(std::visit([](auto&& attribute) { return attribute.size_in_bytes(); }, attribute));
+}
+
+template<typename T>
+auto to_normalized(float value) -> T
+{
+    value = std::clamp(value, std::is_signed_v<T> ? -1.f : 0.f, 1.f);
+    return static_cast<T>(std::lround(value * static_cast<float>(std::numeric_limits<T>::max())));
+}
+
+/// Packs the 4 components in a single integer, with 10 bits for x, y and z, and 2 bits for w.
+template<bool is_signed>
+auto to_normalized_2_10_10_10(std::array<float, 4> const& components) -> uint32_t
+{
+    auto const pack = [](float value, int bits_count) -> uint32_t {
+        if constexpr (is_signed)
+        {
+            auto const max = static_cast<float>((1 << (bits_count - 1)) - 1);
+            auto const res = static_cast<int32_t>(std::lround(std::clamp(value, -1.f, 1.f) * max));
+            return static_cast<uint32_t>(res) & ((1u << bits_count) - 1); // Two's complement, on `bits_count` bits
+        }
+        else
+        {
+            auto const max = static_cast<float>((1 << bits_count) - 1);
+            return static_cast<uint32_t>(std::lround(std::clamp(value, 0.f, 1.f) * max));
+        }
+    };
+    return pack(components[0], 10) | (pack(components[1], 10) << 10) | (pack(components[2], 10) << 20) | (pack(components[3], 2) << 30);
+}
+
+/// Writes the attribute of a single vertex, converted to the format of `Attribute`.
+template<typename Attribute>
+void write_attribute(std::array<float, 4> const& components, std::byte* destination)
+{
+    auto const write_components = [&]<typename T>(auto&& convert) {
+        for (size_t i = 0; i < static_cast<size_t>(Attribute::size()); ++i)
+        {
+            T const value = convert(components[i]);
+            std::memcpy(destination + i * sizeof(T), &value, sizeof(T)); // NOLINT(*pointer-arithmetic)
+        }
+    };
+
+    if constexpr (Attribute::type() == GL_INT_2_10_10_10_REV)
+    {
+        auto const value = to_normalized_2_10_10_10<true>(components);
+        std::memcpy(destination, &value, sizeof(value));
+    }
+    else if constexpr (Attribute::type() == GL_UNSIGNED_INT_2_10_10_10_REV)
+    {
+        auto const value = to_normalized_2_10_10_10<false>(components);
+        std::memcpy(destination, &value, sizeof(value));
+    }
+    else if constexpr (Attribute::type() == GL_FLOAT)
+        write_components.template operator()<float>([](float value) { return value; });
+    else if constexpr (Attribute::type() == GL_HALF_FLOAT)
+        write_components.template operator()<uint16_t>([](float value) { return internal::float_to_half(value); });
+    else if constexpr (Attribute::type() == GL_INT)
+        write_components.template operator()<int32_t>([](float value) { return static_cast<int32_t>(std::lround(value)); });
+    else if constexpr (Attribute::type() == GL_UNSIGNED_BYTE)
+        write_components.template operator()<uint8_t>([](float value) { return to_normalized<uint8_t>(value); });
+    else if constexpr (Attribute::type() == GL_BYTE)
+        write_components.template operator()<int8_t>([](float value) { return to_normalized<int8_t>(value); });
+    else if constexpr (Attribute::type() == GL_UNSIGNED_SHORT)
+        write_components.template operator()<uint16_t>([](float value) { return to_normalized<uint16_t>(value); });
+    else if constexpr (Attribute::type() == GL_SHORT)
+        write_components.template operator()<int16_t>([](float value) { return to_normalized<int16_t>(value); });
+    else
+        static_assert(std::is_void_v<Attribute>, "Unsupported vertex attribute type");
+}
+
+} // namespace
+
+auto quantize_mesh(MeshData const& mesh, std::vector<AnyVertexAttribute> layout) -> QuantizedMeshData
+{
+    assert(layout.size() == mesh.layout.size() && "The new layout must have one attribute for each attribute of the mesh.");
+
+    size_t const floats_per_vertex = mesh.floats_per_vertex();
+    size_t const vertices_count    = mesh.vertices_count();
+    size_t const stride            = std::accumulate(layout.begin(), layout.end(), size_t{0}, [](size_t acc, AnyVertexAttribute const& attribute) {
+        return acc + attribute_size_in_bytes(attribute);
+    });
+
+    auto res = QuantizedMeshData{.layout = std::move(layout), .vertices = std::vector<std::byte>(vertices_count * stride), .indices = mesh.indices};
+
+    size_t source_offset      = 0; // In floats
+    size_t destination_offset = 0; // In bytes
+    for (size_t attribute_index = 0; attribute_index < res.layout.size(); ++attribute_index)
+    {
+        assert(locations_count(mesh.layout[attribute_index]) == 1 && locations_count(res.layout[attribute_index]) == 1 && "Matrices can't be quantized.");
+        size_t const components_count = attribute_size_in_bytes(mesh.layout[attribute_index]) / sizeof(float);
+        auto const   convert          = [&]<typename Attribute>(Attribute const&) {
+            for (size_t vertex = 0; vertex < vertices_count; ++vertex)
+            {
+                auto components = std::array<float, 4>{0.f, 0.f, 0.f, 1.f};
+                std::copy_n(mesh.vertices.begin() + static_cast<std::ptrdiff_t>(vertex * floats_per_vertex + source_offset), std::min<size_t>(components_count, 4), components.begin());
+                write_attribute<Attribute>(components, res.vertices.data() + vertex * stride + destination_offset); // NOLINT(*pointer-arithmetic)
+            }
+        };
+        std::visit(convert, res.layout[attribute_index]);
+        source_offset += components_count;
+        destination_offset += attribute_size_in_bytes(res.layout[attribute_index]);
+    }
+    return res;
+}
+
+auto make_mesh(QuantizedMeshData const& data) -> Mesh
+{
+    auto const vertex_buffers = std::vector{VertexBuffer_Descriptor{.layout = data.layout, .bytes = data.vertices}};
+    return Mesh{Mesh_Descriptor{.vertex_buffers = vertex_buffers, .index_buffer = data.indices}};
+}
+
+} // namespace gl
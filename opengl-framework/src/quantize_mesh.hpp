@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Mesh.hpp"
+#include "MeshData.hpp"
+
+namespace gl {
+
+/// Like MeshData, but the vertices can use any format (e.g. VertexAttribute::HalfVec2), so they are stored as raw bytes.
+struct QuantizedMeshData {
+    std::vector<AnyVertexAttribute> layout{};
+    std::vector<std::byte>          vertices{}; // Interleaved, as described by `layout`
+    std::vector<uint32_t>           indices{};
+};
+
+/// Converts each attribute of `mesh` to the format of the attribute at the same position in `layout` (e.g. a VertexAttribute::Normal3D to a VertexAttribute::PackedNormal3D), so that the mesh uses less memory and bandwidth on the GPU.
+/// `layout` must have as many attributes as `mesh.layout`. Normalized formats clamp the values to their range ([0, 1] or [-1, 1]).
+/// When the new format has more components than the original one, the missing ones are filled like OpenGL does: 0 for y and z, and 1 for w.
+auto quantize_mesh(MeshData const& mesh, std::vector<AnyVertexAttribute> layout) -> QuantizedMeshData;
+
+/// Uploads `data` to the GPU.
+auto make_mesh(QuantizedMeshData const& data) -> Mesh;
+
+namespace internal {
+/// Rounds to the nearest half float (ties to even), like the GPU does.
+auto float_to_half(float value) -> uint16_t;
+auto half_to_float(uint16_t value) -> float;
+} // namespace internal
+
+} // namespace gl
@@ -1,18 +1,26 @@
 #version 410
 
+// Define SHADOWS as 0 (see gl::Shader_Descriptor::defines) to get a variant that doesn't sample the shadow map at all
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+
 in vec3 position_ws;
 in vec2 uv;
 in vec3 normal_ws;
 in vec4 frag_position_light_space;
 
 uniform sampler2D texture_sampler;
+#if SHADOWS
 uniform sampler2D shadow_map;
+#endif
 
 uniform vec3 light_color;
 uniform vec3 light_position_ws;
 
 out vec4 out_color;
 
+#if SHADOWS
 float calculate_shadow(vec4 frag_pos_light)
 {
     vec3 proj_coords = frag_pos_light.xyz / frag_pos_light.w;
@@ -26,6 +34,7 @@ float calculate_shadow(vec4 frag_pos_light)
 
     return shadow;
 }
+#endif
 
 void main()
 {
@@ -34,7 +43,11 @@ void main()
     vec3 light_dir = normalize(light_position_ws - position_ws);
     float diff = max(dot(normal_ws, light_dir), 0.0);
 
+#if SHADOWS
     float shadow = calculate_shadow(frag_position_light_space);
+#else
+    float shadow = 1.0;
+#endif
 
     vec3 color = albedo * light_color * diff * shadow;
 
@@ -0,0 +1,8 @@
+// Helpers for the shaders that draw in screen space, where y goes from -1 to 1 and x is scaled by the aspect ratio, like in utils::draw_disk() etc.
+
+uniform float u_inverse_aspect_ratio;
+
+vec4 screen_space_to_clip_space(vec2 position)
+{
+    return vec4(position * vec2(u_inverse_aspect_ratio, 1.), 0., 1.);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+/// Allocator that can be used with std::vector to make sure its data is aligned for SIMD loads and stores.
+template<typename T, size_t Alignment>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template<typename U>
+    AlignedAllocator(AlignedAllocator<U, Alignment> const&) noexcept // NOLINT(*explicit-constructor)
+    {}
+
+    auto allocate(size_t count) -> T*
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+    }
+    void deallocate(T* ptr, size_t) noexcept
+    {
+        ::operator delete(ptr, std::align_val_t{Alignment});
+    }
+
+    template<typename U>
+    auto operator==(AlignedAllocator<U, Alignment> const&) const -> bool { return true; }
+};
+
+/// Alignment that is enough for all the SIMD instruction sets we use (AVX registers are 32 bytes wide).
+inline constexpr size_t simd_alignment = 32;
@@ -0,0 +1,43 @@
+#include "ArcLengthTable.hpp"
+#include <algorithm>
+
+auto ArcLengthTable::t_in_segment(size_t segment_index, float length) const -> float
+{
+    auto const segment_start  = _cumulative_lengths[segment_index];
+    auto const segment_length = _cumulative_lengths[segment_index + 1] - segment_start;
+    auto const local_t        = segment_length > 0.f ? (length - segment_start) / segment_length : 0.f;
+    return (static_cast<float>(segment_index) + local_t) / static_cast<float>(_cumulative_lengths.size() - 1);
+}
+
+auto ArcLengthTable::t_at_length(float length) const -> float
+{
+    if (length <= 0.f)
+        return 0.f;
+    if (length >= this->length())
+        return 1.f;
+
+    auto const it            = std::upper_bound(_cumulative_lengths.begin(), _cumulative_lengths.end(), length);
+    auto const segment_index = static_cast<size_t>(it - _cumulative_lengths.begin()) - 1;
+    return t_in_segment(segment_index, length);
+}
+
+void ArcLengthTable::evenly_spaced_ts(std::span<float> ts) const
+{
+    if (ts.empty())
+        return;
+    if (ts.size() == 1)
+    {
+        ts[0] = 0.f;
+        return;
+    }
+
+    size_t segment_index = 0;
+    for (size_t i = 0; i < ts.size(); ++i)
+    {
+        auto const length = static_cast<float>(i) / static_cast<float>(ts.size() - 1) * this->length();
+        // The lengths we look for are increasing, so we never need to go back in the table
+        while (segment_index + 2 < _cumulative_lengths.size() && _cumulative_lengths[segment_index + 1] < length)
+            ++segment_index;
+        ts[i] = std::clamp(t_in_segment(segment_index, length), 0.f, 1.f);
+    }
+}
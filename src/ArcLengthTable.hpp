@@ -0,0 +1,45 @@
+#pragma once
+#include <cassert>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+
+/// Precomputed cumulative lengths of a curve, to convert between arc length and curve parameter `t`.
+/// Useful to place points evenly along a curve, because points that are evenly spaced in `t` are usually not evenly spaced along the curve.
+class ArcLengthTable {
+public:
+    /// `curve` must have an `evaluate(std::span<float const> ts, std::span<glm::vec2> out)` method, like Bezier does.
+    /// More samples give a more precise table.
+    template<typename Curve>
+    explicit ArcLengthTable(Curve const& curve, size_t samples_count = 256)
+    {
+        assert(samples_count >= 2);
+        auto ts = std::vector<float>(samples_count);
+        for (size_t i = 0; i < samples_count; ++i)
+            ts[i] = static_cast<float>(i) / static_cast<float>(samples_count - 1);
+        auto points = std::vector<glm::vec2>(samples_count);
+        curve.evaluate(ts, points);
+
+        _cumulative_lengths.resize(samples_count);
+        _cumulative_lengths[0] = 0.f;
+        for (size_t i = 1; i < samples_count; ++i)
+            _cumulative_lengths[i] = _cumulative_lengths[i - 1] + glm::distance(points[i - 1], points[i]);
+    }
+
+    auto length() const -> float { return _cumulative_lengths.back(); }
+
+    /// Returns the `t` at which the curve has travelled `length` since its start.
+    auto t_at_length(float length) const -> float;
+    /// Same as t_at_length(), but `fraction` is expressed between 0 and 1 instead of between 0 and length().
+    auto t_at_fraction(float fraction) const -> float { return t_at_length(fraction * length()); }
+
+    /// Fills `ts` with parameters that are evenly spaced along the curve: the first one is 0 and the last one is 1.
+    /// Much cheaper than calling t_at_length() for each of them, since we can walk the table only once.
+    void evenly_spaced_ts(std::span<float> ts) const;
+
+private:
+    auto t_in_segment(size_t segment_index, float length) const -> float;
+
+private:
+    std::vector<float> _cumulative_lengths{}; // _cumulative_lengths[i] is the length of the curve between t = 0 and t = i / (size - 1)
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include "glm/glm.hpp"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define BEZIER_USE_SSE 1
+#endif
+
+/// Evaluates the Bezier curve defined by `points` at `t`.
+/// The reduction happens in place: `points` is used as scratch memory, and its content is destroyed.
+template<typename Vec>
+constexpr auto de_casteljau_in_place(std::span<Vec> points, float t) -> Vec
+{
+    assert(!points.empty());
+    for (size_t level = points.size() - 1; level > 0; --level)
+    {
+        for (size_t i = 0; i < level; ++i)
+            points[i] = (1.f - t) * points[i] + t * points[i + 1];
+    }
+    return points[0];
+}
+
+/// Bezier curve whose degree is known at compile time, so that evaluating it never allocates.
+template<size_t Degree, typename Vec = glm::vec2>
+struct Bezier {
+    static constexpr size_t points_count = Degree + 1;
+
+    std::array<Vec, points_count> control_points{};
+
+    constexpr auto operator()(float t) const -> Vec
+    {
+        auto scratch = control_points; // Lives on the stack
+        return de_casteljau_in_place(std::span<Vec>{scratch}, t);
+    }
+
+    /// Splits the curve at `t` into two curves of the same degree: the first one goes from 0 to `t`, and the second one from `t` to 1.
+    constexpr auto split(float t) const -> std::pair<Bezier, Bezier>
+    {
+        auto scratch = control_points;
+        auto left    = Bezier{};
+        auto right   = Bezier{};
+
+        left.control_points[0]       = scratch[0];
+        right.control_points[Degree] = scratch[Degree];
+        for (size_t level = 1; level <= Degree; ++level)
+        {
+            for (size_t i = 0; i + level <= Degree; ++i)
+                scratch[i] = (1.f - t) * scratch[i] + t * scratch[i + 1];
+            left.control_points[level]           = scratch[0];
+            right.control_points[Degree - level] = scratch[Degree - level];
+        }
+        return {left, right};
+    }
+
+    /// The hodograph: the exact derivative of this curve with respect to t, which is itself a Bezier curve of one degree less.
+    constexpr auto derivative() const -> Bezier<Degree - 1, Vec>
+        requires(Degree > 0)
+    {
+        auto res = Bezier<Degree - 1, Vec>{};
+        for (size_t i = 0; i < Degree; ++i)
+            res.control_points[i] = static_cast<float>(Degree) * (control_points[i + 1] - control_points[i]);
+        return res;
+    }
+
+    auto tangent(float t) const -> Vec
+        requires(Degree > 0)
+    {
+        return glm::normalize(derivative()(t));
+    }
+
+    /// Tangent rotated by 90 degrees counter-clockwise.
+    auto normal(float t) const -> glm::vec2
+        requires(Degree > 0 && std::is_same_v<Vec, glm::vec2>)
+    {
+        auto const tangent = this->tangent(t);
+        return glm::vec2{-tangent.y, tangent.x};
+    }
+
+    /// Signed curvature (inverse of the radius of the osculating circle), positive when the curve turns counter-clockwise.
+    auto curvature(float t) const -> float
+        requires(Degree > 0 && std::is_same_v<Vec, glm::vec2>)
+    {
+        if constexpr (Degree < 2)
+        {
+            return 0.f; // Straight line
+        }
+        else
+        {
+            auto const first_derivative = derivative();
+            auto const d1               = first_derivative(t);
+            auto const d2               = first_derivative.derivative()(t);
+            auto const speed            = glm::length(d1);
+            return (d1.x * d2.y - d1.y * d2.x) / (speed * speed * speed);
+        }
+    }
+
+    /// Evaluates the curve at all the `ts`, and writes the results in `out`. Uses SIMD to evaluate several `t`s at once when possible.
+    void evaluate(std::span<float const> ts, std::span<Vec> out) const
+    {
+        assert(out.size() >= ts.size());
+        size_t i = 0;
+#if BEZIER_USE_SSE
+        if constexpr (std::is_same_v<Vec, glm::vec2>)
+        {
+            __m128 xs[points_count]; // NOLINT(*c-arrays, *member-init) std::array<__m128> would drop __m128's alignment attributes
+            __m128 ys[points_count]; // NOLINT(*c-arrays, *member-init)
+            for (; i + 4 <= ts.size(); i += 4)
+            {
+                // Each SIMD lane runs de Casteljau for one of the 4 `t`s
+                auto const t  = _mm_loadu_ps(ts.data() + i);
+                auto const mt = _mm_sub_ps(_mm_set1_ps(1.f), t);
+                for (size_t p = 0; p < points_count; ++p)
+                {
+                    xs[p] = _mm_set1_ps(control_points[p].x);
+                    ys[p] = _mm_set1_ps(control_points[p].y);
+                }
+                for (size_t level = Degree; level > 0; --level)
+                {
+                    for (size_t p = 0; p < level; ++p)
+                    {
+                        xs[p] = _mm_add_ps(_mm_mul_ps(mt, xs[p]), _mm_mul_ps(t, xs[p + 1]));
+                        ys[p] = _mm_add_ps(_mm_mul_ps(mt, ys[p]), _mm_mul_ps(t, ys[p + 1]));
+                    }
+                }
+                // Interleave the Xs and Ys back into 4 glm::vec2
+                auto* const dst = &out[i].x;
+                _mm_storeu_ps(dst, _mm_unpacklo_ps(xs[0], ys[0]));
+                _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(xs[0], ys[0]));
+            }
+        }
+#endif
+        for (; i < ts.size(); ++i)
+            out[i] = (*this)(ts[i]);
+    }
+};
+
+using QuadraticBezier = Bezier<2>;
+using CubicBezier     = Bezier<3>;
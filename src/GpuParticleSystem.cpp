@@ -0,0 +1,73 @@
+#include "GpuParticleSystem.hpp"
+#include <cassert>
+
+static constexpr GLuint workgroup_size = 256; // Must match local_size_x in the compute shader
+
+static auto make_update_shader() -> gl::Shader
+{
+    return gl::Shader{
+        gl::ComputeShader_Descriptor{
+            .compute = gl::ShaderSource::Code{R"GLSL(
+#version 430
+
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 0) buffer Positions {
+    vec2 positions[];
+};
+layout(std430, binding = 1) readonly buffer Velocities {
+    vec2 velocities[];
+};
+
+uniform int u_particles_count;
+uniform float u_delta_time;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= uint(u_particles_count))
+        return;
+    positions[i] += velocities[i] * u_delta_time;
+}
+)GLSL"},
+        }};
+}
+
+struct UpdateShader {
+    gl::Shader               shader          = make_update_shader();
+    gl::UniformHandle<int>   particles_count = shader.uniform<int>("u_particles_count");
+    gl::UniformHandle<float> delta_time      = shader.uniform<float>("u_delta_time");
+};
+
+GpuParticleSystem::GpuParticleSystem(std::span<glm::vec2 const> positions, std::span<glm::vec2 const> velocities)
+    : _positions{positions, gl::BufferUsage::Dynamic}
+    , _velocities{velocities, gl::BufferUsage::Static}
+    , _size{positions.size()}
+{
+    assert(positions.size() == velocities.size());
+    assert(gl::compute_shaders_are_supported() && "GpuParticleSystem requires compute shaders, which are not available on this machine. Use ParticleSystem instead.");
+}
+
+void GpuParticleSystem::update(float delta_time)
+{
+    if (_size == 0)
+        return;
+
+    static auto update = UpdateShader{};
+    update.shader.bind();
+    update.shader.set_uniform(update.particles_count, static_cast<int>(_size));
+    update.shader.set_uniform(update.delta_time, delta_time);
+    _positions.bind_as_storage_buffer(0);
+    _velocities.bind_as_storage_buffer(1);
+    update.shader.dispatch((static_cast<GLuint>(_size) + workgroup_size - 1) / workgroup_size);
+
+    // Make sure the new positions are visible to the draw calls and to the buffer reads that will follow
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+auto GpuParticleSystem::download_positions() const -> std::vector<glm::vec2>
+{
+    auto res = std::vector<glm::vec2>(_size);
+    _positions.get_data(std::span{res});
+    return res;
+}
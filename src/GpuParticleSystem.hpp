@@ -0,0 +1,33 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "ParticleSystem.hpp"
+#include "glm/glm.hpp"
+#include "opengl-framework/opengl-framework.hpp"
+
+/// Same simulation as ParticleSystem, but the particles live in GPU memory and are updated by a compute shader.
+/// Rendering can then read the positions straight from GPU memory (see utils::draw_disks()), so there is no per-frame upload at all.
+/// Requires compute shaders, check gl::compute_shaders_are_supported() before creating one.
+class GpuParticleSystem {
+public:
+    GpuParticleSystem(std::span<glm::vec2 const> positions, std::span<glm::vec2 const> velocities);
+    /// Uploads a snapshot of the particles of `particles`.
+    explicit GpuParticleSystem(ParticleSystem const& particles)
+        : GpuParticleSystem{particles.positions(), particles.velocities()}
+    {}
+
+    /// Moves all the particles according to their velocity.
+    void update(float delta_time);
+
+    auto size() const -> size_t { return _size; }
+    /// Tightly packed array of size() glm::vec2.
+    auto positions_buffer() const -> gl::Buffer const& { return _positions; }
+
+    /// Reads the positions back from the GPU. This stalls until the GPU is done, so only use it for debugging and tests.
+    auto download_positions() const -> std::vector<glm::vec2>;
+
+private:
+    gl::Buffer _positions;
+    gl::Buffer _velocities;
+    size_t     _size{};
+};
@@ -0,0 +1,102 @@
+#include "ParticleSystem.hpp"
+#include <cassert>
+#include "opengl-framework/opengl-framework.hpp"
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+/// positions[i] += velocities[i] * delta_time, for `count` floats.
+static void integrate(float* positions, float const* velocities, size_t count, float delta_time)
+{
+    size_t i = 0;
+#if defined(__AVX__)
+    auto const dt8 = _mm256_set1_ps(delta_time);
+    for (; i + 8 <= count; i += 8)
+    {
+#if defined(__FMA__)
+        auto const result = _mm256_fmadd_ps(_mm256_load_ps(velocities + i), dt8, _mm256_load_ps(positions + i));
+#else
+        auto const result = _mm256_add_ps(_mm256_load_ps(positions + i), _mm256_mul_ps(_mm256_load_ps(velocities + i), dt8));
+#endif
+        _mm256_store_ps(positions + i, result);
+    }
+#endif
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    auto const dt4 = _mm_set1_ps(delta_time);
+    for (; i + 4 <= count; i += 4)
+    {
+        auto const result = _mm_add_ps(_mm_load_ps(positions + i), _mm_mul_ps(_mm_load_ps(velocities + i), dt4));
+        _mm_store_ps(positions + i, result);
+    }
+#endif
+    for (; i < count; ++i) // Scalar fallback, and leftovers that don't fill a whole SIMD register
+        positions[i] += velocities[i] * delta_time;
+}
+
+auto ParticleSystem::spawn(glm::vec2 position, glm::vec2 velocity) -> ParticleId
+{
+    auto const particle_index = static_cast<uint32_t>(_positions.size());
+    _positions.push_back(position);
+    _velocities.push_back(velocity);
+
+    uint32_t slot; // NOLINT(*init-variables)
+    if (!_free_slots.empty())
+    {
+        slot = _free_slots.back();
+        _free_slots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(_slots.size());
+        _slots.emplace_back();
+    }
+    _slots[slot].particle_index = particle_index;
+    _slot_of_particle.push_back(slot);
+
+    return ParticleId{.slot = slot, .generation = _slots[slot].generation};
+}
+
+void ParticleSystem::kill(ParticleId id)
+{
+    assert(is_alive(id) && "This particle has already been killed.");
+    auto const index = _slots[id.slot].particle_index;
+    auto const last  = static_cast<uint32_t>(_positions.size() - 1);
+
+    // Move the last particle in the hole, so that alive particles stay contiguous
+    _positions[index]                               = _positions[last];
+    _velocities[index]                              = _velocities[last];
+    _slot_of_particle[index]                        = _slot_of_particle[last];
+    _slots[_slot_of_particle[index]].particle_index = index;
+    _positions.pop_back();
+    _velocities.pop_back();
+    _slot_of_particle.pop_back();
+
+    _slots[id.slot].generation++; // Invalidates all the ParticleIds that refer to this slot
+    _free_slots.push_back(id.slot);
+}
+
+auto ParticleSystem::is_alive(ParticleId id) const -> bool
+{
+    return id.slot < _slots.size() && _slots[id.slot].generation == id.generation;
+}
+
+void ParticleSystem::reserve(size_t particles_count)
+{
+    _positions.reserve(particles_count);
+    _velocities.reserve(particles_count);
+    _slot_of_particle.reserve(particles_count);
+    _slots.reserve(particles_count);
+}
+
+void ParticleSystem::update(float delta_time)
+{
+    static_assert(sizeof(glm::vec2) == 2 * sizeof(float));
+    auto* const       positions  = reinterpret_cast<float*>(_positions.data());         // NOLINT(*reinterpret-cast)
+    auto const* const velocities = reinterpret_cast<float const*>(_velocities.data()); // NOLINT(*reinterpret-cast)
+
+    // Chunks are big enough to amortize the scheduling cost, and a multiple of 8 floats so that each one stays aligned for SIMD
+    constexpr size_t chunk_size = 16 * 1024;
+    gl::job_system().parallel_for(2 * _positions.size(), chunk_size, [&](size_t begin, size_t end) {
+        integrate(positions + begin, velocities + begin, end - begin, delta_time);
+    });
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "AlignedAllocator.hpp"
+#include "glm/glm.hpp"
+
+/// Stays valid even when other particles are spawned or killed. Once its particle is killed, the id is invalidated and will never refer to another particle.
+struct ParticleId {
+    uint32_t slot{};
+    uint32_t generation{};
+};
+
+/// Stores the particles as a structure of arrays: all the positions are contiguous in memory, and so are all the velocities.
+/// Alive particles are always packed at the beginning of these arrays, so that they can be integrated with SIMD and uploaded to the GPU as-is.
+class ParticleSystem {
+public:
+    auto spawn(glm::vec2 position, glm::vec2 velocity) -> ParticleId;
+    /// The last particle is moved in place of the killed one, so this invalidates the order of positions() and velocities() (but not the ParticleIds).
+    void kill(ParticleId);
+    auto is_alive(ParticleId) const -> bool;
+    void reserve(size_t particles_count);
+
+    /// Moves all the particles according to their velocity.
+    void update(float delta_time);
+
+    auto size() const -> size_t { return _positions.size(); }
+    auto positions() const -> std::span<glm::vec2 const> { return _positions; }
+    auto velocities() const -> std::span<glm::vec2 const> { return _velocities; }
+
+private:
+    struct Slot {
+        uint32_t particle_index{};
+        uint32_t generation{};
+    };
+
+private:
+    std::vector<glm::vec2, AlignedAllocator<glm::vec2, simd_alignment>> _positions{};
+    std::vector<glm::vec2, AlignedAllocator<glm::vec2, simd_alignment>> _velocities{};
+    std::vector<uint32_t>                                               _slot_of_particle{}; // Maps a particle index back to its slot, so that we can fix the slot when we move the particle
+    std::vector<Slot>                                                   _slots{};
+    std::vector<uint32_t>                                               _free_slots{};
+};
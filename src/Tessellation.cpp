@@ -0,0 +1,7 @@
+#include "Tessellation.hpp"
+#include "opengl-framework/opengl-framework.hpp"
+
+auto pixels_to_screen_units(float pixels) -> float
+{
+    return 2.f * pixels / static_cast<float>(gl::framebuffer_height_in_pixels());
+}
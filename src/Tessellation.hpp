@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <ranges>
+#include <vector>
+#include "Bezier.hpp"
+#include "glm/glm.hpp"
+
+/// Converts a distance in pixels into the units used by utils::draw_xxx() (where the height of the window spans from -1 to 1).
+auto pixels_to_screen_units(float pixels) -> float;
+
+namespace internal {
+/// Biggest distance between the inner control points and the segment joining the two end points (not the infinite line through them).
+/// The curve lies inside the convex hull of its control points, so it can't be any further away from that segment than this.
+template<size_t Degree>
+auto flatness_error(Bezier<Degree> const& curve) -> float
+{
+    auto const  start          = curve.control_points.front();
+    auto const  chord          = curve.control_points.back() - start;
+    float const length_squared = glm::dot(chord, chord);
+
+    float error = 0.f;
+    for (size_t i = 1; i < Degree; ++i)
+    {
+        auto const to_point = curve.control_points[i] - start;
+        // Clamp the projection to the segment, otherwise control points that are aligned with the chord but overshoot its ends would count as flat, while the curve goes past the ends
+        float const t = length_squared > 1e-14f
+                            ? std::clamp(glm::dot(to_point, chord) / length_squared, 0.f, 1.f)
+                            : 0.f;
+        error = std::max(error, glm::length(to_point - t * chord));
+    }
+    return error;
+}
+
+template<size_t Degree>
+void tessellate_without_first_point(Bezier<Degree> const& curve, float tolerance, std::vector<glm::vec2>& out, int remaining_depth)
+{
+    if (remaining_depth == 0 || flatness_error(curve) <= tolerance)
+    {
+        out.push_back(curve.control_points.back());
+        return;
+    }
+    auto const [first_half, second_half] = curve.split(0.5f);
+    tessellate_without_first_point(first_half, tolerance, out, remaining_depth - 1);
+    tessellate_without_first_point(second_half, tolerance, out, remaining_depth - 1);
+}
+
+inline constexpr int max_subdivision_depth = 16; // Protects against degenerate curves, 2^16 segments is more than any curve will ever need
+} // namespace internal
+
+/// Appends to `out` points along `curve` such that the polyline they form never deviates from the curve by more than `tolerance`.
+/// Flat parts of the curve get few points, tight bends get many.
+/// `out` is not cleared: clear it yourself if you want to reuse its memory for a new polyline.
+template<size_t Degree>
+void tessellate(Bezier<Degree> const& curve, float tolerance, std::vector<glm::vec2>& out)
+{
+    out.push_back(curve.control_points.front());
+    internal::tessellate_without_first_point(curve, tolerance, out, internal::max_subdivision_depth);
+}
+
+/// Same as tessellate(), for a chain of Bezier curves where each one starts where the previous one ends (e.g. a spline).
+/// The points shared by two consecutive curves are only emitted once.
+template<std::ranges::forward_range Curves>
+void tessellate_chain(Curves const& curves, float tolerance, std::vector<glm::vec2>& out)
+{
+    if (std::ranges::empty(curves))
+        return;
+    out.push_back(std::ranges::begin(curves)->control_points.front());
+    for (auto const& curve : curves)
+        internal::tessellate_without_first_point(curve, tolerance, out, internal::max_subdivision_depth);
+}
@@ -1,5 +1,11 @@
 #include "utils.hpp"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
 #include <random>
+#include <string>
+#include <vector>
 #include "opengl-framework/opengl-framework.hpp"
 
 namespace utils
@@ -39,19 +45,30 @@ namespace utils
 #version 410
 
 layout(location = 0) in vec2 in_position;
-layout(location = 1) in vec2 in_uv;
+layout(location = 1) in float in_radius;
+layout(location = 2) in vec4 in_color;
 
-uniform vec2 u_position;
-uniform float u_radius;
-uniform float u_inverse_aspect_ratio;
+#include "res/screen_space.glsl"
+
+const vec2 quadOffsets[6] = vec2[](
+    vec2(-1.0, -1.0),
+    vec2( 1.0, -1.0),
+    vec2( 1.0,  1.0),
+    vec2(-1.0, -1.0),
+    vec2( 1.0,  1.0),
+    vec2(-1.0,  1.0)
+);
 
 out vec2 v_uv;
+out vec4 v_color;
 
 void main()
 {
-    vec2 position = u_position + u_radius * in_position;
-    gl_Position = vec4(position * vec2(u_inverse_aspect_ratio, 1.), 0., 1.);
-    v_uv = in_uv;
+    vec2 offset = quadOffsets[gl_VertexID];
+    vec2 position = in_position + in_radius * offset;
+    gl_Position = screen_space_to_clip_space(position);
+    v_uv = offset * 0.5 + 0.5;
+    v_color = in_color;
 }
 )GLSL"}),
                 .fragment = gl::ShaderSource::Code({R"GLSL(
@@ -59,30 +76,142 @@ void main()
 
 out vec4 out_color;
 in vec2 v_uv;
-uniform vec4 u_color;
+in vec4 v_color;
 
 void main()
 {
     vec2 dir = v_uv - vec2(0.5);
     if (dot(dir, dir) > 0.25)
         discard;
-    out_color = u_color;
+    out_color = v_color;
 }
 )GLSL"}),
             }};
     }
 
+    /// The shader, and its uniforms looked up once and for all.
+    struct DiskShader {
+        gl::Shader               shader               = make_disk_shader();
+        gl::UniformHandle<float> inverse_aspect_ratio = shader.uniform<float>("u_inverse_aspect_ratio");
+    };
+
+    static auto disk_shader() -> DiskShader const&
+    {
+        static auto instance = DiskShader{};
+        return instance;
+    }
+
+    struct DiskInstance {
+        glm::vec2 position;
+        float     radius;
+        glm::vec4 color;
+    };
+
+    /// Accumulates all the disks of a frame on the CPU, and draws them all at once with a single instanced draw call.
+    class DiskBatch {
+    public:
+        DiskBatch()
+        {
+            glGenVertexArrays(1, &_vertex_array);
+            gl::state_cache().bind_vertex_array(_vertex_array);
+            glGenBuffers(1, &_instance_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, _instance_buffer);
+
+            constexpr auto stride = static_cast<GLsizei>(sizeof(DiskInstance));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(DiskInstance, position))); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+            glVertexAttribDivisor(0, 1);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(DiskInstance, radius))); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+            glVertexAttribDivisor(1, 1);
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(DiskInstance, color))); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+            glVertexAttribDivisor(2, 1);
+
+            gl::add_end_of_frame_callback([this]() { flush(); });
+        }
+        ~DiskBatch()
+        {
+            glDeleteBuffers(1, &_instance_buffer);
+            gl::state_cache().forget_vertex_array(_vertex_array);
+            glDeleteVertexArrays(1, &_vertex_array);
+        }
+        DiskBatch(DiskBatch const&)                    = delete;
+        auto operator=(DiskBatch const&) -> DiskBatch& = delete;
+        DiskBatch(DiskBatch&&)                         = delete;
+        auto operator=(DiskBatch&&) -> DiskBatch&      = delete;
+
+        void push(DiskInstance const& instance) { _instances.push_back(instance); }
+        void reserve_additional(size_t count) { _instances.reserve(_instances.size() + count); }
+
+        void flush()
+        {
+            if (_instances.empty())
+                return;
+
+            disk_shader().shader.bind();
+            disk_shader().shader.set_uniform(disk_shader().inverse_aspect_ratio, 1.f / gl::framebuffer_aspect_ratio());
+
+            gl::state_cache().bind_vertex_array(_vertex_array);
+            glBindBuffer(GL_ARRAY_BUFFER, _instance_buffer);
+            // Re-specifying the whole storage each frame lets the driver orphan the previous one instead of waiting for the GPU to be done with it
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_instances.size() * sizeof(DiskInstance)), _instances.data(), GL_STREAM_DRAW);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(_instances.size()));
+
+            _instances.clear(); // Keeps the capacity, so that next frame doesn't need to allocate
+        }
+
+    private:
+        std::vector<DiskInstance> _instances{};
+        GLuint                    _vertex_array{};
+        GLuint                    _instance_buffer{};
+    };
+
+    static auto disk_batch() -> DiskBatch&
+    {
+        static auto instance = DiskBatch{};
+        return instance;
+    }
+
     void draw_disk(glm::vec2 position, float radius, glm::vec4 const& color)
     {
-        static auto square_mesh = make_square_mesh();
-        static auto disk_shader = make_disk_shader();
-
-        disk_shader.bind();
-        disk_shader.set_uniform("u_position", position);
-        disk_shader.set_uniform("u_radius", radius);
-        disk_shader.set_uniform("u_inverse_aspect_ratio", 1.f / gl::framebuffer_aspect_ratio());
-        disk_shader.set_uniform("u_color", color);
-        square_mesh.draw();
+        disk_batch().push({.position = position, .radius = radius, .color = color});
+    }
+
+    void draw_disks(std::span<glm::vec2 const> positions, float radius, glm::vec4 const& color)
+    {
+        disk_batch().reserve_additional(positions.size());
+        for (auto const& position : positions)
+            disk_batch().push({.position = position, .radius = radius, .color = color});
+    }
+
+    void draw_disks(gl::Buffer const& positions, size_t count, float radius, glm::vec4 const& color)
+    {
+        if (count == 0)
+            return;
+
+        static auto const vertex_array = []() {
+            GLuint id{};
+            glGenVertexArrays(1, &id);
+            gl::state_cache().bind_vertex_array(id);
+            glEnableVertexAttribArray(0);
+            glVertexAttribDivisor(0, 1);
+            // Attributes 1 (radius) and 2 (color) stay disabled, so that the shader reads the constant values we set with glVertexAttrib*()
+            return id;
+        }();
+        disk_shader().shader.bind();
+        disk_shader().shader.set_uniform(disk_shader().inverse_aspect_ratio, 1.f / gl::framebuffer_aspect_ratio());
+        gl::state_cache().bind_vertex_array(vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, positions.id());
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), nullptr);
+        glVertexAttrib1f(1, radius);
+        glVertexAttrib4f(2, color.r, color.g, color.b, color.a);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(count));
+    }
+
+    void flush_disks()
+    {
+        disk_batch().flush();
     }
 
     static auto make_line_shader() -> gl::Shader
@@ -95,7 +224,8 @@ void main()
 uniform vec2 u_start;
 uniform vec2 u_end;
 uniform float u_thickness;
-uniform float u_inverse_aspect_ratio;
+
+#include "res/screen_space.glsl"
 
 const vec2 quadOffsets[4] = vec2[](
     vec2(-1.0, -1.0),
@@ -114,7 +244,7 @@ void main()
              + quadOffsets[gl_VertexID].x * (u_end - u_start) * 0.5
              + quadOffsets[gl_VertexID].y * normal * u_thickness * 0.5;
 
-    gl_Position = vec4(pos * vec2(u_inverse_aspect_ratio, 1.), 0., 1.);
+    gl_Position = screen_space_to_clip_space(pos);
 }
 )GLSL"}),
                 .fragment = gl::ShaderSource::Code({R"GLSL(
@@ -131,41 +261,246 @@ void main()
             }};
     }
 
+    struct LineShader {
+        gl::Shader                   shader               = make_line_shader();
+        gl::UniformHandle<glm::vec2> start                = shader.uniform<glm::vec2>("u_start");
+        gl::UniformHandle<glm::vec2> end                  = shader.uniform<glm::vec2>("u_end");
+        gl::UniformHandle<float>     thickness            = shader.uniform<float>("u_thickness");
+        gl::UniformHandle<float>     inverse_aspect_ratio = shader.uniform<float>("u_inverse_aspect_ratio");
+        gl::UniformHandle<glm::vec4> color                = shader.uniform<glm::vec4>("u_color");
+    };
+
     void draw_line(glm::vec2 start, glm::vec2 end, float thickness, glm::vec4 const& color)
     {
         static auto line_mesh = make_square_mesh();
-        static auto line_shader = make_line_shader();
-
-        line_shader.bind();
-        line_shader.set_uniform("u_start", start);
-        line_shader.set_uniform("u_end", end);
-        line_shader.set_uniform("u_thickness", thickness);
-        line_shader.set_uniform("u_inverse_aspect_ratio", 1.f / gl::framebuffer_aspect_ratio());
-        line_shader.set_uniform("u_color", color);
+        static auto line      = LineShader{};
+
+        line.shader.bind();
+        line.shader.set_uniform(line.start, start);
+        line.shader.set_uniform(line.end, end);
+        line.shader.set_uniform(line.thickness, thickness);
+        line.shader.set_uniform(line.inverse_aspect_ratio, 1.f / gl::framebuffer_aspect_ratio());
+        line.shader.set_uniform(line.color, color);
         line_mesh.draw();
     }
 
-    void draw_polyline(std::vector<glm::vec2> const& points, bool closed, float thickness, glm::vec4 const& color)
+    /// The join is chosen with the JOIN define rather than with a uniform, so that each variant only contains the code it needs, and the fragment shader of the other joins doesn't pay for the round join.
+    static auto polyline_shader_descriptor(LineJoin join) -> gl::Shader_Descriptor
     {
-        for (size_t i = 0; i < points.size() - 1; ++i)
-            draw_line(points[i], points[i + 1], thickness, color);
+        return gl::Shader_Descriptor{
+            .vertex = gl::ShaderSource::Code({R"GLSL(
+#version 410
+
+uniform samplerBuffer u_points;
+uniform int u_points_count;
+uniform bool u_closed;
+uniform float u_thickness;
+
+#include "res/screen_space.glsl"
+
+out vec2 v_position;
+flat out vec2 v_start;
+flat out vec2 v_end;
+
+#define JOIN_NONE 0
+#define JOIN_MITER 1
+#define JOIN_ROUND 2
+const float MITER_LIMIT = 4.;
+
+// Corner of the segment's quad: x selects the start (0) or the end (1) of the segment, y selects the side
+const vec2 quadCorners[6] = vec2[](
+    vec2(0., -1.),
+    vec2(1., -1.),
+    vec2(1.,  1.),
+    vec2(0., -1.),
+    vec2(1.,  1.),
+    vec2(0.,  1.)
+);
 
-        if (closed && points.size() > 2)
-            draw_line(points.back(), points.front(), thickness, color);
+bool has_point(int index)
+{
+    return u_closed || (index >= 0 && index < u_points_count);
+}
+
+vec2 point(int index)
+{
+    return texelFetch(u_points, (index + u_points_count) % u_points_count).xy;
+}
+
+// (0, 0) for a zero-length segment (e.g. duplicate consecutive points), instead of the NaN that normalize() would give
+vec2 direction_of(vec2 start, vec2 end)
+{
+    vec2 delta = end - start;
+    float length_squared = dot(delta, delta);
+    return length_squared > 1e-12 ? delta * inversesqrt(length_squared) : vec2(0.);
+}
+
+vec2 normal_of(vec2 start, vec2 end)
+{
+    vec2 dir = direction_of(start, end);
+    return vec2(-dir.y, dir.x);
+}
+
+// Offset that makes our segment meet its neighbour on the bisector of the two segments
+vec2 miter_offset(vec2 normal, vec2 neighbour_normal)
+{
+    vec2 sum = normal + neighbour_normal;
+    if (dot(normal, normal) < 0.5) // Our segment has a zero length, so it must stay degenerate
+        return normal;
+    if (dot(sum, sum) < 1e-6) // The polyline turns back on itself, so there is no bisector: fall back to a bevel
+        return normal;
+    vec2 miter = normalize(sum);
+    float length_ratio = 1. / max(dot(miter, normal), 1. / MITER_LIMIT);
+    return miter * length_ratio;
+}
+
+void main()
+{
+    int segment = gl_VertexID / 6;
+    vec2 corner = quadCorners[gl_VertexID % 6];
+
+    vec2 start = point(segment);
+    vec2 end = point(segment + 1);
+    vec2 dir = direction_of(start, end);
+    vec2 normal = vec2(-dir.y, dir.x);
+
+    vec2 pos = corner.x < 0.5 ? start : end;
+    vec2 offset = normal;
+#if JOIN == JOIN_MITER
+    if (corner.x < 0.5 && has_point(segment - 1))
+        offset = miter_offset(normal, normal_of(point(segment - 1), start));
+    else if (corner.x > 0.5 && has_point(segment + 2))
+        offset = miter_offset(normal, normal_of(end, point(segment + 2)));
+#elif JOIN == JOIN_ROUND
+    // Extend the quad so that it can contain the round caps, that will be carved out by the fragment shader
+    pos += (corner.x < 0.5 ? -dir : dir) * u_thickness * 0.5;
+#endif
+    pos += corner.y * offset * u_thickness * 0.5;
+
+    v_position = pos;
+    v_start = start;
+    v_end = end;
+    gl_Position = screen_space_to_clip_space(pos);
+}
+)GLSL"}),
+            .fragment = gl::ShaderSource::Code({R"GLSL(
+#version 410
+
+out vec4 out_color;
+in vec2 v_position;
+flat in vec2 v_start;
+flat in vec2 v_end;
+uniform vec4 u_color;
+uniform float u_thickness;
+
+#define JOIN_ROUND 2
+
+float distance_to_segment(vec2 p, vec2 a, vec2 b)
+{
+    vec2 ab = b - a;
+    float t = clamp(dot(p - a, ab) / max(dot(ab, ab), 1e-12), 0., 1.);
+    return length(p - (a + t * ab));
+}
+
+void main()
+{
+#if JOIN == JOIN_ROUND
+    if (distance_to_segment(v_position, v_start, v_end) > u_thickness * 0.5)
+        discard;
+#endif
+    out_color = u_color;
+}
+)GLSL"}),
+            .defines = {{.name = "JOIN", .value = std::to_string(static_cast<int>(join))}},
+        };
     }
 
-    glm::vec2 de_casteljau(const std::vector<glm::vec2>& points, float t) {
-    std::vector<glm::vec2> temp = points;
+    /// Holds the GPU copy of the points of the polyline we are drawing, exposed to the shader as a buffer texture.
+    class PolylinePoints {
+    public:
+        PolylinePoints()
+        {
+            glGenVertexArrays(1, &_empty_vertex_array); // The shader generates everything from gl_VertexID, but core profile still requires a VAO to be bound
+            glGenBuffers(1, &_buffer);
+            glGenTextures(1, &_texture);
+            glBindBuffer(GL_TEXTURE_BUFFER, _buffer);
+            glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec2), nullptr, GL_STREAM_DRAW);
+            gl::state_cache().bind_texture(0, GL_TEXTURE_BUFFER, _texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32F, _buffer);
+        }
+        ~PolylinePoints()
+        {
+            gl::state_cache().forget_texture(_texture);
+            glDeleteTextures(1, &_texture);
+            glDeleteBuffers(1, &_buffer);
+            gl::state_cache().forget_vertex_array(_empty_vertex_array);
+            glDeleteVertexArrays(1, &_empty_vertex_array);
+        }
+        PolylinePoints(PolylinePoints const&)                    = delete;
+        auto operator=(PolylinePoints const&) -> PolylinePoints& = delete;
+        PolylinePoints(PolylinePoints&&)                         = delete;
+        auto operator=(PolylinePoints&&) -> PolylinePoints&      = delete;
 
-    while (temp.size() > 1) {
-        std::vector<glm::vec2> next;
-        for (size_t i = 0; i < temp.size() - 1; ++i) {
-            next.push_back((1 - t) * temp[i] + t * temp[i + 1]);
+        void upload(std::span<glm::vec2 const> points) const
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, _buffer);
+            glBufferData(GL_TEXTURE_BUFFER, static_cast<GLsizeiptr>(points.size_bytes()), points.data(), GL_STREAM_DRAW); // Orphans the previous storage, so we never wait for the GPU to be done with the previous polyline
         }
-        temp = next;
+
+        auto texture() const -> GLuint { return _texture; }
+        auto empty_vertex_array() const -> GLuint { return _empty_vertex_array; }
+
+    private:
+        GLuint _empty_vertex_array{};
+        GLuint _buffer{};
+        GLuint _texture{};
+    };
+
+    struct PolylineShader {
+        explicit PolylineShader(LineJoin join)
+            : shader{gl::shared_shader(polyline_shader_descriptor(join))}
+        {}
+
+        std::shared_ptr<gl::Shader const> shader;
+        gl::UniformHandle<int>            points               = shader->uniform<int>("u_points");
+        gl::UniformHandle<int>            points_count         = shader->uniform<int>("u_points_count");
+        gl::UniformHandle<bool>           closed               = shader->uniform<bool>("u_closed");
+        gl::UniformHandle<float>          thickness            = shader->uniform<float>("u_thickness");
+        gl::UniformHandle<float>          inverse_aspect_ratio = shader->uniform<float>("u_inverse_aspect_ratio");
+        gl::UniformHandle<glm::vec4>      color                = shader->uniform<glm::vec4>("u_color");
+    };
+
+    /// Each join is only compiled the first time it is used.
+    static auto polyline_shader(LineJoin join) -> PolylineShader const&
+    {
+        static auto instances = std::array<std::optional<PolylineShader>, 3>{};
+        auto&       instance  = instances[static_cast<size_t>(join)];
+        if (!instance.has_value())
+            instance.emplace(join);
+        return *instance;
     }
 
-    return temp[0];
+    void draw_polyline(std::span<glm::vec2 const> points, bool closed, float thickness, glm::vec4 const& color, LineJoin join)
+    {
+        if (points.size() < 2)
+            return;
+
+        static auto const polyline_points = PolylinePoints{};
+        auto const&       polyline        = polyline_shader(join);
+
+        polyline_points.upload(points);
+        auto const segments_count = closed && points.size() > 2 ? points.size() : points.size() - 1;
+
+        polyline.shader->bind();
+        gl::state_cache().bind_texture(1, GL_TEXTURE_BUFFER, polyline_points.texture()); // Not slot 0, which is used for texture operations, see Shader::set_uniform(Texture)
+        polyline.shader->set_uniform(polyline.points, 1);
+        polyline.shader->set_uniform(polyline.points_count, static_cast<int>(points.size()));
+        polyline.shader->set_uniform(polyline.closed, closed && points.size() > 2);
+        polyline.shader->set_uniform(polyline.thickness, thickness);
+        polyline.shader->set_uniform(polyline.inverse_aspect_ratio, 1.f / gl::framebuffer_aspect_ratio());
+        polyline.shader->set_uniform(polyline.color, color);
+        gl::state_cache().bind_vertex_array(polyline_points.empty_vertex_array());
+        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(6 * segments_count));
     }
 
 }
@@ -1,12 +1,27 @@
 #pragma once
 #include "glm/glm.hpp"
-#include <vector>
+#include "opengl-framework/opengl-framework.hpp"
+#include <span>
 
 namespace utils
 {
     float rand(float min, float max);
 
+    /// Disks are not drawn immediately: they are accumulated and then all drawn at once at the end of the frame (or by flush_disks()).
     void draw_disk(glm::vec2 position, float radius, glm::vec4 const& color);
+    /// Same as calling draw_disk() for each position, but cheaper.
+    void draw_disks(std::span<glm::vec2 const> positions, float radius, glm::vec4 const& color);
+    /// Draws `count` disks whose positions are read straight from GPU memory (`positions` must contain tightly packed glm::vec2).
+    /// Unlike the other overloads, the disks are drawn immediately, with a single draw call.
+    void draw_disks(gl::Buffer const& positions, size_t count, float radius, glm::vec4 const& color);
+    /// Draws all the disks requested since the last flush, with a single draw call. This is done automatically at the end of each frame, so you only need it if you want the disks to be drawn below something else.
+    void flush_disks();
     void draw_line(glm::vec2 start, glm::vec2 end, float thickness, glm::vec4 const& color);
-    void draw_polyline(std::vector<glm::vec2> const& points, bool closed, float thickness, glm::vec4 const& color);
+    enum class LineJoin {
+        None  = 0,
+        Miter = 1,
+        Round = 2, // Also gives round caps at both ends of the polyline
+    };
+    /// Draws the whole polyline with a single draw call.
+    void draw_polyline(std::span<glm::vec2 const> points, bool closed, float thickness, glm::vec4 const& color, LineJoin join = LineJoin::Miter);
 }